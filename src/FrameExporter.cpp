@@ -0,0 +1,139 @@
+#include "FrameExporter.h"
+
+FrameExporter::~FrameExporter() {
+	stop();
+}
+
+void FrameExporter::start(const std::string & directory, FrameCodec codec, int numThreads) {
+	stop();
+
+	this->directory = directory;
+	this->codec = codec;
+	ofDirectory::createDirectory(directory, false, true);
+
+	if(numThreads <= 0) {
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// one thread takes the frames in the order they came in
+	if(codec == FrameCodec::TILE_DELTA) {
+		numThreads = 1;
+		tileStream.open(ofFilePath::join(directory, "frames.tds"));
+	}
+
+	// enough frames to keep every thread busy, without buffering the whole animation in memory
+	maxFramesInFlight = numThreads * 2;
+	framesInFlight = 0;
+	stopping = false;
+	numFrames = 0;
+	rawBytes = 0;
+	encodedBytes = 0;
+	startTime = std::chrono::steady_clock::now();
+
+	for(int i = 0; i < numThreads; i++) {
+		threads.emplace_back(&FrameExporter::encodeLoop, this);
+	}
+}
+
+void FrameExporter::addFrame(ofPixels & pixels) {
+	auto frame = std::make_shared<Frame>();
+	frame->index = numFrames++;
+	frame->pixels.swap(pixels);
+	rawBytes += frame->pixels.getTotalBytes();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	frameWritten.wait(lock, [this] { return framesInFlight < maxFramesInFlight; });
+	framesInFlight++;
+
+	if(codec == FrameCodec::PNG) {
+		int height = frame->pixels.getHeight();
+		int numChunks = (height + rowsPerChunk - 1) / rowsPerChunk;
+		frame->chunks.resize(numChunks);
+		frame->chunksLeft = numChunks;
+		for(int i = 0; i < numChunks; i++) {
+			tasks.push_back({frame, i});
+		}
+	} else {
+		tasks.push_back({frame, 0});
+	}
+	lock.unlock();
+	taskAdded.notify_all();
+}
+
+FrameExporter::Report FrameExporter::stop() {
+	Report report;
+	if(threads.empty()) {
+		return report;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	taskAdded.notify_all();
+	for(auto & thread: threads) {
+		thread.join();
+	}
+	threads.clear();
+	tileStream.close();
+
+	report.frames = numFrames;
+	report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+	report.rawBytes = rawBytes;
+	report.encodedBytes = encodedBytes;
+	if(report.seconds > 0.0) {
+		report.framesPerSecond = report.frames / report.seconds;
+		report.megabytesPerSecond = report.rawBytes / (1024.0 * 1024.0) / report.seconds;
+	}
+	return report;
+}
+
+void FrameExporter::encodeLoop() {
+	std::vector<uint8_t> data;
+	while(true) {
+		Task task;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			taskAdded.wait(lock, [this] { return stopping || !tasks.empty(); });
+			if(tasks.empty()) {
+				return; // stopping and nothing left to encode
+			}
+			task = std::move(tasks.front());
+			tasks.pop_front();
+		}
+
+		Frame & frame = *task.frame;
+		if(codec == FrameCodec::TILE_DELTA) {
+			encodedBytes += tileStream.addFrame(frame.pixels);
+		} else if(codec == FrameCodec::PNG) {
+			int firstRow = task.chunk * rowsPerChunk;
+			int numRows = std::min<int>(rowsPerChunk, frame.pixels.getHeight() - firstRow);
+			ImageEncoder::encodePNGChunk(frame.pixels, firstRow, numRows, frame.chunks[task.chunk]);
+
+			// whoever finishes the last chunk puts the file together
+			if(--frame.chunksLeft > 0) {
+				continue;
+			}
+			ImageEncoder::assemblePNG(frame.pixels, frame.chunks, data);
+			writeFrame(frame, data);
+		} else {
+			ImageEncoder::encodeQOI(frame.pixels, data);
+			writeFrame(frame, data);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			framesInFlight--;
+		}
+		frameWritten.notify_one();
+	}
+}
+
+void FrameExporter::writeFrame(const Frame & frame, const std::vector<uint8_t> & data) {
+	char name[32];
+	snprintf(name, sizeof(name), "frame_%05d.%s", frame.index, codec == FrameCodec::PNG ? "png" : "qoi");
+
+	std::ofstream file(ofFilePath::join(directory, name), std::ios::binary);
+	file.write(reinterpret_cast<const char *>(data.data()), data.size());
+	encodedBytes += data.size();
+}
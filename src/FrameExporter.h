@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ofMain.h"
+#include "ImageEncoder.h"
+#include "TileStream.h"
+
+enum class FrameCodec {
+	QOI,
+	PNG,
+	TILE_DELTA // one frames.tds file with only the tiles that changed, see TileStream.h
+};
+
+// Writes exported frames as a numbered image sequence, encoding them on a pool of threads.
+// The pool works on tasks rather than whole frames: a QOI frame is one task, a PNG frame is one task
+// per chunk of rows, so even a single frame keeps every encoder thread busy.
+// The tile delta stream is the exception: every frame depends on the one before, so it runs on a single thread.
+class FrameExporter {
+public:
+	struct Report {
+		int frames = 0;
+		double seconds = 0.0;
+		size_t rawBytes = 0;
+		size_t encodedBytes = 0;
+		double framesPerSecond = 0.0;
+		double megabytesPerSecond = 0.0; // of raw pixels going through the encoders
+	};
+
+	~FrameExporter();
+
+	// 0 threads = one per core
+	void start(const std::string & directory, FrameCodec codec, int numThreads = 0);
+	// takes the pixels (the caller gets an empty ofPixels back), blocks while the encoders are too far behind
+	void addFrame(ofPixels & pixels);
+	// waits for every queued frame to be written
+	Report stop();
+
+	bool isRunning() const { return !threads.empty(); }
+
+private:
+	struct Frame {
+		int index = 0;
+		ofPixels pixels;
+		std::vector<ImageEncoder::PNGChunk> chunks;
+		std::atomic<int> chunksLeft{0};
+	};
+
+	struct Task {
+		std::shared_ptr<Frame> frame;
+		int chunk = 0;
+	};
+
+	void encodeLoop();
+	void writeFrame(const Frame & frame, const std::vector<uint8_t> & data);
+
+	static const int rowsPerChunk = 64;
+
+	std::string directory;
+	FrameCodec codec = FrameCodec::QOI;
+	std::vector<std::thread> threads;
+	TileStreamWriter tileStream;
+
+	std::mutex mutex;
+	std::condition_variable taskAdded;
+	std::condition_variable frameWritten;
+	std::deque<Task> tasks;
+	int framesInFlight = 0;
+	int maxFramesInFlight = 0;
+	bool stopping = false;
+
+	int numFrames = 0;
+	size_t rawBytes = 0;
+	std::atomic<size_t> encodedBytes{0};
+	std::chrono::steady_clock::time_point startTime;
+};
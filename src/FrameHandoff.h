@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
+// Hands frames from one producer thread to one consumer thread through two buffers.
+// The producer fills one buffer while the consumer reads the other, and a single atomic slot says which
+// buffer holds a finished frame the consumer hasn't taken yet. The producer can only run one frame ahead:
+// it waits until the consumer has taken the last frame before filling the buffer the consumer just let go of.
+// The slot itself is lock-free; the mutex is only there so a thread that has to wait can sleep instead of spinning.
+template<typename T>
+class FrameHandoff {
+public:
+	// producer: waits until the next buffer is free and returns it to be filled,
+	// or nullptr if running turned false while waiting
+	T * beginWrite(const std::atomic<bool> & running) {
+		if(ready.load(std::memory_order_acquire) != EMPTY) {
+			std::unique_lock<std::mutex> lock(mutex);
+			slotChanged.wait(lock, [&] { return ready.load(std::memory_order_acquire) == EMPTY || !running; });
+			if(ready.load(std::memory_order_acquire) != EMPTY) {
+				return nullptr;
+			}
+		}
+		return &buffers[back];
+	}
+
+	// producer: hands the filled buffer over to the consumer
+	void publish() {
+		ready.store(back, std::memory_order_release);
+		back ^= 1;
+		wake();
+	}
+
+	// consumer: waits for the next frame, which stays valid until the next call to read(),
+	// or nullptr if running turned false while waiting
+	const T * read(const std::atomic<bool> & running) {
+		int index = ready.exchange(EMPTY, std::memory_order_acq_rel);
+		if(index == EMPTY) {
+			std::unique_lock<std::mutex> lock(mutex);
+			slotChanged.wait(lock, [&] { return (index = ready.exchange(EMPTY, std::memory_order_acq_rel)) != EMPTY || !running; });
+			if(index == EMPTY) {
+				return nullptr;
+			}
+		}
+		wake();
+		return &buffers[index];
+	}
+
+	// wakes up whoever is waiting, call it after running turns false
+	void wake() {
+		// taking the lock means a waiting thread is either asleep already or hasn't checked the slot yet, so it can't miss this
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+		}
+		slotChanged.notify_all();
+	}
+
+	// only while neither thread is using it
+	void reset() {
+		ready = EMPTY;
+		back = 0;
+	}
+
+private:
+	static const int EMPTY = -1;
+
+	T buffers[2];
+	std::atomic<int> ready{EMPTY};
+	int back = 0; // the buffer the producer fills next, only the producer touches this
+
+	std::mutex mutex;
+	std::condition_variable slotChanged;
+};
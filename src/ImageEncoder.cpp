@@ -0,0 +1,158 @@
+#include "ImageEncoder.h"
+#include <zlib.h>
+
+namespace {
+	void putBigEndian(std::vector<uint8_t> & out, uint32_t value) {
+		out.push_back(value >> 24);
+		out.push_back(value >> 16);
+		out.push_back(value >> 8);
+		out.push_back(value);
+	}
+
+	void putPNGChunk(std::vector<uint8_t> & out, const char * type, const uint8_t * data, size_t length) {
+		putBigEndian(out, length);
+		size_t start = out.size();
+		out.insert(out.end(), type, type + 4);
+		out.insert(out.end(), data, data + length);
+		putBigEndian(out, crc32(0, out.data() + start, length + 4));
+	}
+}
+
+void ImageEncoder::encodeQOI(const ofPixels & pixels, std::vector<uint8_t> & out) {
+	const int width = pixels.getWidth();
+	const int height = pixels.getHeight();
+	const int channels = pixels.getNumChannels();
+	const uint8_t * data = pixels.getData();
+
+	out.clear();
+	out.reserve(14 + width * height * (channels + 1) + 8);
+	out.insert(out.end(), {'q', 'o', 'i', 'f'});
+	putBigEndian(out, width);
+	putBigEndian(out, height);
+	out.push_back(channels);
+	out.push_back(0); // sRGB with linear alpha
+
+	struct Pixel {
+		uint8_t r, g, b, a;
+		bool operator==(const Pixel & o) const { return r == o.r && g == o.g && b == o.b && a == o.a; }
+	};
+	Pixel index[64] = {};
+	Pixel prev = {0, 0, 0, 255};
+	int run = 0;
+
+	const size_t numPixels = static_cast<size_t>(width) * height;
+	for(size_t i = 0; i < numPixels; i++) {
+		const uint8_t * p = data + i * channels;
+		Pixel px = {p[0], p[1], p[2], channels == 4 ? p[3] : static_cast<uint8_t>(255)};
+
+		if(px == prev) {
+			run++;
+			if(run == 62 || i == numPixels - 1) {
+				out.push_back(0xc0 | (run - 1)); // QOI_OP_RUN
+				run = 0;
+			}
+			continue;
+		}
+		if(run > 0) {
+			out.push_back(0xc0 | (run - 1));
+			run = 0;
+		}
+
+		int hash = (px.r * 3 + px.g * 5 + px.b * 7 + px.a * 11) % 64;
+		if(index[hash] == px) {
+			out.push_back(hash); // QOI_OP_INDEX
+		} else {
+			index[hash] = px;
+			if(px.a == prev.a) {
+				int8_t dr = px.r - prev.r;
+				int8_t dg = px.g - prev.g;
+				int8_t db = px.b - prev.b;
+				int8_t drg = dr - dg;
+				int8_t dbg = db - dg;
+				if(dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+					out.push_back(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)); // QOI_OP_DIFF
+				} else if(dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+					out.push_back(0x80 | (dg + 32)); // QOI_OP_LUMA
+					out.push_back((drg + 8) << 4 | (dbg + 8));
+				} else {
+					out.insert(out.end(), {0xfe, px.r, px.g, px.b}); // QOI_OP_RGB
+				}
+			} else {
+				out.insert(out.end(), {0xff, px.r, px.g, px.b, px.a}); // QOI_OP_RGBA
+			}
+		}
+		prev = px;
+	}
+
+	out.insert(out.end(), {0, 0, 0, 0, 0, 0, 0, 1});
+}
+
+void ImageEncoder::encodePNGChunk(const ofPixels & pixels, int firstRow, int numRows, PNGChunk & chunk) {
+	const int channels = pixels.getNumChannels();
+	const size_t stride = pixels.getWidth() * channels;
+	const uint8_t * data = pixels.getData() + firstRow * stride;
+
+	// the sub filter (difference to the pixel on the left) on every row instead of picking the best filter per row,
+	// our frames are mostly flat colours so this turns almost everything into runs of zeros
+	std::vector<uint8_t> filtered((stride + 1) * numRows);
+	uint8_t * dst = filtered.data();
+	for(int y = 0; y < numRows; y++) {
+		const uint8_t * row = data + y * stride;
+		*dst++ = 1; // filter type: sub
+		for(int i = 0; i < channels; i++) {
+			*dst++ = row[i];
+		}
+		for(size_t i = channels; i < stride; i++) {
+			*dst++ = row[i] - row[i - channels];
+		}
+	}
+
+	chunk.length = filtered.size();
+	chunk.adler = adler32(adler32(0, nullptr, 0), filtered.data(), filtered.size());
+
+	// raw deflate at the fastest level, run length matching is all the sub filter needs
+	z_stream stream = {};
+	deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, -15, 8, Z_RLE);
+	chunk.deflated.resize(deflateBound(&stream, filtered.size()) + 16);
+	stream.next_in = filtered.data();
+	stream.avail_in = filtered.size();
+	stream.next_out = chunk.deflated.data();
+	stream.avail_out = chunk.deflated.size();
+	while(deflate(&stream, Z_SYNC_FLUSH) == Z_OK && stream.avail_out == 0) {
+		size_t used = chunk.deflated.size();
+		chunk.deflated.resize(used * 2);
+		stream.next_out = chunk.deflated.data() + used;
+		stream.avail_out = chunk.deflated.size() - used;
+	}
+	chunk.deflated.resize(stream.total_out);
+	deflateEnd(&stream);
+}
+
+void ImageEncoder::assemblePNG(const ofPixels & pixels, const std::vector<PNGChunk> & chunks, std::vector<uint8_t> & out) {
+	out.clear();
+	out.insert(out.end(), {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'});
+
+	std::vector<uint8_t> header;
+	putBigEndian(header, pixels.getWidth());
+	putBigEndian(header, pixels.getHeight());
+	header.push_back(8); // bit depth
+	header.push_back(pixels.getNumChannels() == 4 ? 6 : 2); // RGBA or RGB
+	header.push_back(0); // deflate
+	header.push_back(0); // adaptive filtering
+	header.push_back(0); // no interlace
+	putPNGChunk(out, "IHDR", header.data(), header.size());
+
+	// zlib stream: header, the chunks back to back, an empty final block, then the combined checksum
+	std::vector<uint8_t> stream = {0x78, 0x01};
+	uint32_t adler = adler32(0, nullptr, 0);
+	for(const auto & chunk: chunks) {
+		stream.insert(stream.end(), chunk.deflated.begin(), chunk.deflated.end());
+		adler = adler32_combine(adler, chunk.adler, chunk.length);
+	}
+	stream.push_back(0x03); // final block, fixed huffman, end of block
+	stream.push_back(0x00);
+	putBigEndian(stream, adler);
+	putPNGChunk(out, "IDAT", stream.data(), stream.size());
+
+	putPNGChunk(out, "IEND", nullptr, 0);
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Fast image encoders for exporting frames, trading file size for speed
+// both take 8-bit RGB or RGBA pixels
+namespace ImageEncoder {
+	// QOI (https://qoiformat.org), a single pass over the pixels with no entropy coding
+	void encodeQOI(const ofPixels & pixels, std::vector<uint8_t> & out);
+
+	// PNG is deflated in independent chunks of rows so one frame can be spread across threads:
+	// every chunk ends byte aligned with a sync flush, so the compressed chunks can just be concatenated
+	struct PNGChunk {
+		std::vector<uint8_t> deflated;
+		uint32_t adler = 1;  // adler32 of the filtered rows in this chunk
+		size_t length = 0;   // number of filtered bytes in this chunk
+	};
+	void encodePNGChunk(const ofPixels & pixels, int firstRow, int numRows, PNGChunk & chunk);
+	void assemblePNG(const ofPixels & pixels, const std::vector<PNGChunk> & chunks, std::vector<uint8_t> & out);
+}
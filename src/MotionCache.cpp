@@ -0,0 +1,255 @@
+#include "MotionCache.h"
+
+namespace {
+	// a jump leaves the half way sample right next to one of its neighbours instead of somewhere in between them
+	// (smooth motion, even with easing, puts it roughly in the middle)
+	bool isJump(float a, float mid, float b, float minJump) {
+		float delta = abs(b - a);
+		return delta > minJump && std::min(abs(mid - a), abs(b - mid)) < delta * 0.1f;
+	}
+
+	bool isJump(glm::vec2 a, glm::vec2 mid, glm::vec2 b, float minJump) {
+		float delta = glm::distance(a, b);
+		return delta > minJump && std::min(glm::distance(mid, a), glm::distance(b, mid)) < delta * 0.1f;
+	}
+}
+
+uint8_t MotionCache::poseFlags(const ActorPose & pose) {
+	uint8_t flags = 0;
+	if(pose.visible) {
+		flags |= VISIBLE;
+	}
+	if(pose.pivot == PivotSide::LEFT) {
+		flags |= PIVOT_LEFT;
+	} else if(pose.pivot == PivotSide::RIGHT) {
+		flags |= PIVOT_RIGHT;
+	}
+	return flags;
+}
+
+void MotionCache::Track::encode(const std::vector<float> & raw) {
+	values.resize(raw.size());
+	if(raw.empty()) {
+		return;
+	}
+
+	auto range = std::minmax_element(raw.begin(), raw.end());
+	min = *range.first;
+	step = (*range.second - min) / 65535.0f;
+
+	for(size_t i = 0; i < raw.size(); i++) {
+		float level = step > 0.0f ? round((raw[i] - min) / step) : 0.0f;
+		values[i] = static_cast<uint16_t>(ofClamp(level, 0.0f, 65535.0f));
+	}
+}
+
+size_t MotionCache::ActorTracks::bytes() const {
+	return x.bytes() + y.bytes() + angle.bytes() + scale.bytes() + color.size() * sizeof(ofColor) + flags.size() * sizeof(uint8_t);
+}
+
+void MotionCache::clear() {
+	sampleRate = 0.0f;
+	numSegments = 0;
+	numSamples = 0;
+	segmentStart.clear();
+	trapezoid = ActorTracks();
+	rectangle = ActorTracks();
+	crescent = ActorTracks();
+	windowTilt = Track();
+	timeOfDay = Track();
+	report = Report();
+}
+
+void MotionCache::bake(const std::function<void(SceneState &)> & evaluate, const std::function<void()> & reset,
+	float duration, float sampleRate, float tolerance) {
+	const int segments = std::max(1, static_cast<int>(ceil(duration * sampleRate)));
+	std::vector<int> split(segments, 1);
+
+	// every pass runs the whole timeline again with the segments that were off by too much split in two,
+	// the timeline has state that carries over from frame to frame so it can't just evaluate the missing bits
+	while(true) {
+		clear();
+		this->sampleRate = sampleRate;
+		numSegments = segments;
+
+		std::vector<float> sampleTimes;
+		for(int i = 0; i < segments; i++) {
+			segmentStart.push_back(sampleTimes.size());
+			for(int k = 0; k < split[i]; k++) {
+				sampleTimes.push_back((i + k / static_cast<float>(split[i])) / sampleRate);
+			}
+		}
+		segmentStart.push_back(sampleTimes.size());
+		sampleTimes.push_back(segments / sampleRate);
+		numSamples = sampleTimes.size();
+
+		// every sample and half way to the next one, the in-between states are only used to check the lerp against
+		reset();
+		std::vector<SceneState> states(numSamples);
+		std::vector<SceneState> midStates(numSamples - 1);
+		SceneState state;
+		for(int i = 0; i < numSamples; i++) {
+			state.c = sampleTimes[i];
+			evaluate(state);
+			states[i] = state;
+			if(i + 1 < numSamples) {
+				state.c = (sampleTimes[i] + sampleTimes[i + 1]) / 2.0f;
+				evaluate(state);
+				midStates[i] = state;
+			}
+		}
+
+		auto actorPoses = [](const std::vector<SceneState> & states, ActorPose SceneState::*actor) {
+			std::vector<ActorPose> poses;
+			poses.reserve(states.size());
+			for(const auto & s: states) {
+				poses.push_back(s.*actor);
+			}
+			return poses;
+		};
+		std::vector<float> errors(numSamples, 0.0f);
+		bakeActor(trapezoid, actorPoses(states, &SceneState::trapezoid), actorPoses(midStates, &SceneState::trapezoid), errors);
+		bakeActor(rectangle, actorPoses(states, &SceneState::rectangle), actorPoses(midStates, &SceneState::rectangle), errors);
+		bakeActor(crescent, actorPoses(states, &SceneState::crescent), actorPoses(midStates, &SceneState::crescent), errors);
+
+		std::vector<float> tilts;
+		std::vector<float> times;
+		for(const auto & s: states) {
+			tilts.push_back(s.windowTilt);
+			times.push_back(s.timeOfDay);
+		}
+		windowTilt.encode(tilts);
+		timeOfDay.encode(times);
+
+		bool changed = false;
+		for(int i = 0; i < segments; i++) {
+			float error = *std::max_element(errors.begin() + segmentStart[i], errors.begin() + segmentStart[i + 1]);
+			if(error > tolerance && split[i] < maxSplit) {
+				split[i] *= 2;
+				changed = true;
+			}
+		}
+		if(!changed) {
+			break;
+		}
+	}
+
+	report.numSamples = numSamples;
+	report.numSplitSegments = std::count_if(split.begin(), split.end(), [](int n) { return n > 1; });
+	report.bytes = trapezoid.bytes() + rectangle.bytes() + crescent.bytes() + windowTilt.bytes() + timeOfDay.bytes()
+		+ segmentStart.size() * sizeof(int);
+}
+
+void MotionCache::bakeActor(ActorTracks & tracks, const std::vector<ActorPose> & poses, const std::vector<ActorPose> & midPoses,
+	std::vector<float> & errors) {
+	int n = poses.size();
+	std::vector<float> x(n);
+	std::vector<float> y(n);
+	std::vector<float> angle(n);
+	std::vector<float> scale(n);
+	tracks.color.resize(n);
+	tracks.flags.resize(n);
+
+	// invisible samples repeat the nearest visible pose so they don't stretch the quantization range
+	auto firstVisible = std::find_if(poses.begin(), poses.end(), [](const ActorPose & pose) { return pose.visible; });
+	ActorPose hold = firstVisible != poses.end() ? *firstVisible : ActorPose();
+	for(int i = 0; i < n; i++) {
+		if(poses[i].visible) {
+			hold = poses[i];
+		}
+		x[i] = hold.pos.x;
+		y[i] = hold.pos.y;
+		angle[i] = hold.angle;
+		scale[i] = hold.scale;
+		tracks.color[i] = hold.color;
+		tracks.flags[i] = poseFlags(poses[i]);
+	}
+
+	tracks.x.encode(x);
+	tracks.y.encode(y);
+	tracks.angle.encode(angle);
+	tracks.scale.encode(scale);
+
+	float quantizationError = glm::length(glm::vec2(tracks.x.step, tracks.y.step)) / 2.0f;
+	report.quantizationError = std::max(report.quantizationError, quantizationError);
+
+	// compare the lerp half way between two samples with the real pose there
+	for(int i = 0; i < n - 1; i++) {
+		const ActorPose & a = poses[i];
+		const ActorPose & b = poses[i + 1];
+		const ActorPose & mid = midPoses[i];
+		if(!mid.visible && !a.visible && !b.visible) {
+			continue;
+		}
+
+		bool cut = poseFlags(a) != poseFlags(b) || poseFlags(mid) != poseFlags(a);
+		cut = cut || isJump(a.pos, mid.pos, b.pos, 4.0f);
+		cut = cut || isJump(a.angle, mid.angle, b.angle, 0.1f);
+		cut = cut || isJump(a.scale, mid.scale, b.scale, 0.1f);
+		if(cut) {
+			tracks.flags[i] |= CUT;
+			report.numCuts++;
+			continue;
+		}
+
+		glm::vec2 pos(tracks.x.lerp(i, 0.5f), tracks.y.lerp(i, 0.5f));
+		errors[i] = std::max(errors[i], glm::distance(pos, mid.pos));
+		report.positionError = std::max(report.positionError, errors[i]);
+		report.angleError = std::max(report.angleError, abs(tracks.angle.lerp(i, 0.5f) - mid.angle));
+		report.scaleError = std::max(report.scaleError, abs(tracks.scale.lerp(i, 0.5f) - mid.scale));
+	}
+}
+
+void MotionCache::sample(float time, SceneState & state) const {
+	state.c = time;
+	if(!isBaked()) {
+		return;
+	}
+
+	// find the segment, then the sample inside it
+	float f = ofClamp(time * sampleRate, 0.0f, numSegments);
+	int segment = std::min(static_cast<int>(f), numSegments - 1);
+	int split = segmentStart[segment + 1] - segmentStart[segment];
+	float g = (f - segment) * split;
+	int k = std::min(static_cast<int>(g), split - 1);
+	int i = segmentStart[segment] + k;
+	float t = g - k;
+
+	sampleActor(trapezoid, i, t, state.trapezoid);
+	sampleActor(rectangle, i, t, state.rectangle);
+	sampleActor(crescent, i, t, state.crescent);
+	state.windowTilt = windowTilt.lerp(i, t);
+	state.timeOfDay = timeOfDay.lerp(i, t);
+}
+
+void MotionCache::sampleActor(const ActorTracks & tracks, int i, float t, ActorPose & pose) const {
+	// jumps snap to the nearest sample instead of sliding across the gap
+	if(tracks.flags[i] & CUT) {
+		if(t >= 0.5f) {
+			i++;
+		}
+		t = 0.0f;
+	}
+
+	uint8_t flags = tracks.flags[i];
+	pose.visible = flags & VISIBLE;
+	if(flags & PIVOT_LEFT) {
+		pose.pivot = PivotSide::LEFT;
+	} else if(flags & PIVOT_RIGHT) {
+		pose.pivot = PivotSide::RIGHT;
+	} else {
+		pose.pivot = PivotSide::NONE;
+	}
+
+	if(t > 0.0f) {
+		pose.pos = glm::vec2(tracks.x.lerp(i, t), tracks.y.lerp(i, t));
+		pose.angle = tracks.angle.lerp(i, t);
+		pose.scale = tracks.scale.lerp(i, t);
+		pose.color = tracks.color[i].getLerped(tracks.color[i + 1], t);
+	} else {
+		pose.pos = glm::vec2(tracks.x.decode(i), tracks.y.decode(i));
+		pose.angle = tracks.angle.decode(i);
+		pose.scale = tracks.scale.decode(i);
+		pose.color = tracks.color[i];
+	}
+}
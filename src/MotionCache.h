@@ -0,0 +1,87 @@
+#pragma once
+
+#include "Scene.h"
+
+// The whole story is deterministic after setup, so instead of running the animate*() logic every frame
+// we sample it once and play it back from 16-bit quantized tracks.
+// The timeline is cut into segments at a fixed rate, and segments where the motion is too fast for a lerp
+// between two samples (the crescent's spin) are split into 2, 4, ... samples until it stays within tolerance.
+// Every value gets its own array (structure of arrays), so playback is a few lookups and a lerp per value.
+class MotionCache {
+public:
+	// worst case errors of the baked tracks compared to evaluating the timeline directly
+	struct Report {
+		int numSamples = 0;
+		int numSplitSegments = 0;       // segments that needed more than one sample
+		size_t bytes = 0;
+		float quantizationError = 0.0f; // largest position error from the 16-bit quantization, in pixels
+		float positionError = 0.0f;     // largest position error half way between two samples (includes quantization), in pixels
+		float angleError = 0.0f;        // in radians
+		float scaleError = 0.0f;
+		int numCuts = 0;                // samples where the motion jumps, these are played back without interpolation
+	};
+
+	// evaluate is called with state.c going from 0 to duration, in order, once per pass; reset is called before every pass
+	// to put the timeline back at the start. Segments are split until the position half way between two samples
+	// is within tolerance pixels, or they have maxSplit samples
+	void bake(const std::function<void(SceneState &)> & evaluate, const std::function<void()> & reset,
+		float duration, float sampleRate, float tolerance);
+	void clear();
+
+	// fills in the state at any time, times past the end hold the last sample
+	void sample(float time, SceneState & state) const;
+
+	bool isBaked() const { return numSamples > 0; }
+	const Report & getReport() const { return report; }
+
+private:
+	// a float track quantized to 16 bits over the range of values it actually uses
+	struct Track {
+		float min = 0.0f;
+		float step = 0.0f; // value of one quantization level
+		std::vector<uint16_t> values;
+
+		void encode(const std::vector<float> & raw);
+		float decode(int i) const { return min + values[i] * step; }
+		float lerp(int i, float t) const { return ofLerp(decode(i), decode(i + 1), t); }
+		size_t bytes() const { return values.size() * sizeof(uint16_t); }
+	};
+
+	// per sample flags, packed in a byte
+	enum Flags : uint8_t {
+		VISIBLE = 1 << 0,
+		PIVOT_LEFT = 1 << 1,
+		PIVOT_RIGHT = 1 << 2,
+		CUT = 1 << 3 // the motion jumps between this sample and the next one, don't lerp over it
+	};
+
+	struct ActorTracks {
+		Track x;
+		Track y;
+		Track angle;
+		Track scale;
+		std::vector<ofColor> color;
+		std::vector<uint8_t> flags;
+
+		size_t bytes() const;
+	};
+
+	static const int maxSplit = 32;
+
+	static uint8_t poseFlags(const ActorPose & pose);
+	// errors gets the position error half way after each sample, if it's larger than what's already there
+	void bakeActor(ActorTracks & tracks, const std::vector<ActorPose> & poses, const std::vector<ActorPose> & midPoses,
+		std::vector<float> & errors);
+	void sampleActor(const ActorTracks & tracks, int i, float t, ActorPose & pose) const;
+
+	float sampleRate = 0.0f;
+	int numSegments = 0;
+	int numSamples = 0;
+	std::vector<int> segmentStart; // the first sample of every segment, and one past the last segment
+	ActorTracks trapezoid;
+	ActorTracks rectangle;
+	ActorTracks crescent;
+	Track windowTilt;
+	Track timeOfDay;
+	Report report;
+};
@@ -0,0 +1,196 @@
+#include "Rasterizer.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTERIZER_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+	// the running sum of the signed area along one span of a row, made positive and clamped to 1, is how much of each
+	// pixel is covered (exact unless outlines cross each other inside the pixel). clears the area as it goes
+	void resolveSpan(float * area, float * coverage, const int length) {
+		int i = 0;
+		float sum = 0.0f;
+#ifdef RASTERIZER_SSE2
+		// 4 pixels at a time: a prefix sum inside the register in two shifted adds, plus the total so far
+		const __m128 signBit = _mm_set1_ps(-0.0f);
+		const __m128 one = _mm_set1_ps(1.0f);
+		__m128 total = _mm_setzero_ps();
+		for(; i + 4 <= length; i += 4) {
+			__m128 x = _mm_loadu_ps(area + i);
+			x = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+			x = _mm_add_ps(x, _mm_shuffle_ps(_mm_setzero_ps(), x, 0x40));
+			x = _mm_add_ps(x, total);
+			_mm_storeu_ps(coverage + i, _mm_min_ps(_mm_andnot_ps(signBit, x), one));
+			_mm_storeu_ps(area + i, _mm_setzero_ps());
+			total = _mm_shuffle_ps(x, x, 0xff);
+		}
+		sum = _mm_cvtss_f32(total);
+#endif
+		for(; i < length; i++) {
+			sum += area[i];
+			area[i] = 0.0f;
+			coverage[i] = std::min(std::abs(sum), 1.0f);
+		}
+	}
+}
+
+void Rasterizer::begin(ofPixels & pixels, const int width, const int height, const ofColor & background) {
+	target = &pixels;
+	if(pixels.getWidth() != static_cast<size_t>(width) || pixels.getHeight() != static_cast<size_t>(height)
+		|| pixels.getNumChannels() != 3) {
+		pixels.allocate(width, height, OF_PIXELS_RGB);
+	}
+	pixels.setColor(background);
+
+	// fill() leaves the accumulation buffer cleared, so it only needs to be set up when the size changes
+	if(width != this->width || height != this->height) {
+		this->width = width;
+		this->height = height;
+		stride = width + 2;
+		accumulation.assign(stride * height, 0.0f);
+		coverage.resize(width);
+	}
+	minX = width;
+	maxX = -1;
+	minY = height;
+	maxY = -1;
+}
+
+void Rasterizer::fillText(const ofTrueTypeFont & font, const std::string & text, const float x, const float y, const ofColor & color) {
+	glm::mat4 transform = glm::translate(glm::mat4(1.0f), glm::vec3(x, y, 0));
+	for(auto & glyph: font.getStringAsPoints(text)) {
+		for(const auto & outline: glyph.getOutline()) {
+			addOutline(outline.getVertices().data(), outline.size(), transform);
+		}
+	}
+	fill(color);
+}
+
+// adds the area between the line and the right edge of the image, row by row
+// (the same accumulation as font-rs: https://github.com/raphlinus/font-rs)
+void Rasterizer::addLine(glm::vec2 p0, glm::vec2 p1) {
+	// horizontal lines don't cover anything
+	if(p0.y == p1.y) {
+		return;
+	}
+
+	// split lines that cross the left or right border, then every piece can be moved inside:
+	// left of the image all that matters is that the row is covered from column 0 on, right of it nothing shows
+	for(const float border: {0.0f, static_cast<float>(width)}) {
+		if((p0.x < border && p1.x > border) || (p0.x > border && p1.x < border)) {
+			glm::vec2 crossing(border, ofLerp(p0.y, p1.y, (border - p0.x) / (p1.x - p0.x)));
+			addLine(p0, crossing);
+			addLine(crossing, p1);
+			return;
+		}
+	}
+	p0.x = ofClamp(p0.x, 0, width);
+	p1.x = ofClamp(p1.x, 0, width);
+
+	// always walk down the rows, lines going up take the area away again
+	float direction = 1.0f;
+	if(p0.y > p1.y) {
+		std::swap(p0, p1);
+		direction = -1.0f;
+	}
+	const int firstRow = std::max(0, static_cast<int>(floor(p0.y)));
+	const int endRow = std::min(height, static_cast<int>(ceil(p1.y)));
+	if(firstRow >= endRow) {
+		return;
+	}
+	const float dxdy = (p1.x - p0.x) / (p1.y - p0.y);
+	float x = ofClamp(p0.x + (std::max(p0.y, 0.0f) - p0.y) * dxdy, 0, width);
+
+	minX = std::min(minX, static_cast<int>(floor(std::min(p0.x, p1.x))));
+	maxX = std::max(maxX, static_cast<int>(ceil(std::max(p0.x, p1.x))) + 1);
+	minY = std::min(minY, firstRow);
+	maxY = std::max(maxY, endRow - 1);
+
+	for(int y = firstRow; y < endRow; y++) {
+		float * row = accumulation.data() + y * stride;
+		const float dy = std::min(y + 1.0f, p1.y) - std::max(static_cast<float>(y), p0.y);
+		const float xNext = ofClamp(x + dxdy * dy, 0, width);
+		const float area = dy * direction;
+
+		const float x0 = std::min(x, xNext);
+		const float x1 = std::max(x, xNext);
+		const float x0Floor = floor(x0);
+		const float x1Ceil = ceil(x1);
+		const int x0i = static_cast<int>(x0Floor);
+		const int x1i = static_cast<int>(x1Ceil);
+
+		if(x1i <= x0i + 1) {
+			// inside one pixel, it gets the part right of the line and the next pixel gets the rest
+			const float middle = 0.5f * (x + xNext) - x0Floor;
+			row[x0i] += area - area * middle;
+			row[x0i + 1] += area * middle;
+		} else {
+			// across several pixels: a triangle in the first and last pixel and an even share in between
+			const float share = 1.0f / (x1 - x0);
+			const float x0Fraction = x0 - x0Floor;
+			const float first = 0.5f * share * (1.0f - x0Fraction) * (1.0f - x0Fraction);
+			const float x1Fraction = x1 - x1Ceil + 1.0f;
+			const float last = 0.5f * share * x1Fraction * x1Fraction;
+
+			row[x0i] += area * first;
+			if(x1i == x0i + 2) {
+				row[x0i + 1] += area * (1.0f - first - last);
+			} else {
+				const float second = share * (1.5f - x0Fraction);
+				row[x0i + 1] += area * (second - first);
+				for(int i = x0i + 2; i < x1i - 1; i++) {
+					row[i] += area * share;
+				}
+				const float beforeLast = second + (x1i - x0i - 3) * share;
+				row[x1i - 1] += area * (1.0f - beforeLast - last);
+			}
+			row[x1i] += area * last;
+		}
+		x = xNext;
+	}
+}
+
+void Rasterizer::fill(const ofColor & color) {
+	if(minY <= maxY) {
+		const int lastColumn = std::min(maxX, width - 1);
+		const int length = lastColumn - minX + 1;
+		const float alpha = color.a / 255.0f;
+		const size_t channels = target->getNumChannels();
+
+		for(int y = minY; y <= maxY; y++) {
+			float * row = accumulation.data() + y * stride;
+			if(length > 0) {
+				resolveSpan(row + minX, coverage.data(), length);
+
+				uint8_t * pixel = target->getData() + (static_cast<size_t>(y) * width + minX) * channels;
+				for(int i = 0; i < length; i++, pixel += channels) {
+					const float a = coverage[i] * alpha;
+					if(a < 1.0f / 512) {
+						continue;
+					}
+					if(a > 1.0f - 1.0f / 512) {
+						pixel[0] = color.r;
+						pixel[1] = color.g;
+						pixel[2] = color.b;
+						continue;
+					}
+					pixel[0] = static_cast<uint8_t>(pixel[0] + (color.r - pixel[0]) * a + 0.5f);
+					pixel[1] = static_cast<uint8_t>(pixel[1] + (color.g - pixel[1]) * a + 0.5f);
+					pixel[2] = static_cast<uint8_t>(pixel[2] + (color.b - pixel[2]) * a + 0.5f);
+				}
+			}
+
+			// whatever landed past the right border
+			const int firstCleared = std::max(minX, lastColumn + 1);
+			if(firstCleared <= maxX) {
+				std::fill(row + firstCleared, row + maxX + 1, 0.0f);
+			}
+		}
+	}
+
+	minX = width;
+	maxX = -1;
+	minY = height;
+	maxY = -1;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "ofMain.h"
+
+// Draws filled shapes into ofPixels on the cpu, anti-aliased without supersampling: instead of testing
+// several samples per pixel, every edge adds the exact area it covers to an accumulation buffer
+// (signed, so edges going up take away what edges going down add), and a running sum along each row turns
+// that into how much of each pixel is inside the shape. Each pixel is touched about once, like a 1x fill.
+// Each pixel gets the magnitude of the winding-weighted area inside it, clamped to 1. That's exact for outlines that
+// don't cross themselves, including the holes in glyphs (all of a glyph's outlines go into one shape and the inner
+// ones wind the other way), but it isn't the nonzero rule: where opposite windings share a pixel they cancel out.
+class Rasterizer {
+public:
+	// clears the pixels (8-bit RGB) to the background, everything after draws into them until the next begin()
+	void begin(ofPixels & pixels, int width, int height, const ofColor & background);
+
+	// fills a closed polygon, its points (anything with x and y) transformed by the matrix first
+	template<typename Point>
+	void fillPolygon(const Point * points, size_t numPoints, const glm::mat4 & transform, const ofColor & color) {
+		addOutline(points, numPoints, transform);
+		fill(color);
+	}
+	void fillPolygon(const std::vector<glm::vec2> & points, const glm::mat4 & transform, const ofColor & color) {
+		fillPolygon(points.data(), points.size(), transform, color);
+	}
+
+	// the same text ofTrueTypeFont::drawString() draws at x, y, from the glyph outlines (load the font with makeContours)
+	void fillText(const ofTrueTypeFont & font, const std::string & text, float x, float y, const ofColor & color);
+
+private:
+	template<typename Point>
+	void addOutline(const Point * points, size_t numPoints, const glm::mat4 & transform) {
+		if(numPoints < 3) {
+			return;
+		}
+		glm::vec2 first(transform * glm::vec4(points[0].x, points[0].y, 0, 1));
+		glm::vec2 last = first;
+		for(size_t i = 1; i < numPoints; i++) {
+			glm::vec2 point(transform * glm::vec4(points[i].x, points[i].y, 0, 1));
+			addLine(last, point);
+			last = point;
+		}
+		addLine(last, first);
+	}
+
+	void addLine(glm::vec2 p0, glm::vec2 p1);
+	// turns the accumulated area into coverage, blends the colour in and clears the accumulation for the next shape
+	void fill(const ofColor & color);
+
+	ofPixels * target = nullptr;
+	int width = 0;
+	int height = 0;
+	size_t stride = 0; // of the accumulation buffer, an edge at the right border can write 2 columns past the last pixel
+
+	std::vector<float> accumulation;
+	std::vector<float> coverage; // one row
+
+	// the pixels the current shape touched, so fill() only goes over those
+	int minX = 0;
+	int maxX = -1;
+	int minY = 0;
+	int maxY = -1;
+};
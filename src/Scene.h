@@ -0,0 +1,30 @@
+#pragma once
+
+#include "ofMain.h"
+
+enum class PivotSide {
+	NONE,
+	LEFT,
+	RIGHT
+};
+
+// where and how one character is drawn in a single frame
+struct ActorPose {
+	bool visible = false;
+	glm::vec2 pos = glm::vec2(0, 0);
+	float angle = 0.0f; // in radians
+	float scale = 1.0f;
+	PivotSide pivot = PivotSide::NONE;
+	ofColor color;
+};
+
+// everything draw() needs to render one frame of the animation
+// the animate*() functions fill this in, the draw*() functions only read it
+struct SceneState {
+	float c = 0.0f; // time in the animation this state was evaluated at
+	ActorPose trapezoid;
+	ActorPose rectangle;
+	ActorPose crescent;
+	float windowTilt = 0.0f; // 0 = upright, 1 = every window at its final tilt angle
+	float timeOfDay = 1.0f;  // 0 = night, 1 = day
+};
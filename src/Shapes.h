@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Scene.h"
+
+// The characters' geometry, and the transforms to put them on screen.
+// The transforms are specialized on the pivot side, so each shape/pivot combination is one fixed matrix
+// instead of branching and pushing translate/rotate/scale onto the matrix stack every time it's drawn.
+namespace Shapes {
+	struct Point {
+		float x;
+		float y;
+		operator glm::vec2() const { return glm::vec2(x, y); }
+	};
+
+	// 100 wide at the bottom, 80 at the top and 90 tall, centred on (0, 0)
+	struct Trapezoid {
+		static constexpr Point halfSize = {50, 45};
+		static constexpr Point vertices[4] = {{-40, -45}, {40, -45}, {50, 45}, {-50, 45}};
+	};
+
+	// 240 wide and 400 tall, centred on (0, 0)
+	struct Rectangle {
+		static constexpr Point halfSize = {120, 200};
+		static constexpr Point vertices[4] = {{-120, -200}, {120, -200}, {120, 200}, {-120, 200}};
+	};
+
+	// two arcs on top of each other, 60 wide and 30 tall, centred on (0, 0)
+	struct Crescent {
+		static constexpr Point halfSize = {30, 15};
+		static constexpr float outerArcHeight = 30;
+		static constexpr float innerArcHeight = 16;
+		static constexpr int resolution = 16;
+	};
+
+	// the outline of the crescent, sin() and cos() aren't constexpr so it's worked out once on first use
+	inline const std::vector<glm::vec2> & crescentOutline() {
+		static const std::vector<glm::vec2> outline = [] {
+			std::vector<glm::vec2> points;
+			const float halfWidth = Crescent::halfSize.x;
+
+			// top edge, then the bottom edge going backwards to close the shape
+			for(int i = 0; i <= Crescent::resolution; i++) {
+				float angle = ofMap(i, 0, Crescent::resolution, PI, 0);
+				points.emplace_back(halfWidth * cos(angle), Crescent::halfSize.y - Crescent::outerArcHeight * sin(angle));
+			}
+			for(int i = Crescent::resolution; i >= 0; i--) {
+				float angle = ofMap(i, 0, Crescent::resolution, PI, 0);
+				points.emplace_back(halfWidth * cos(angle), Crescent::halfSize.y - Crescent::innerArcHeight * sin(angle));
+			}
+			return points;
+		}();
+		return outline;
+	}
+
+	// the bottom corner a shape pivots on, in units of half its size (y points down)
+	template<PivotSide P> struct Pivot;
+	template<> struct Pivot<PivotSide::NONE> {
+		static constexpr Point corner = {0, 0};
+	};
+	template<> struct Pivot<PivotSide::LEFT> {
+		static constexpr Point corner = {-1, 1};
+	};
+	template<> struct Pivot<PivotSide::RIGHT> {
+		static constexpr Point corner = {1, 1};
+	};
+
+	// puts the pivot corner at pos, rotates around it and scales, as one matrix
+	// angles are in screen space like ofRotateRad(): y points down, so positive angles turn clockwise
+	template<PivotSide P>
+	glm::mat4 transform(const glm::vec2 pos, const float angle, const float scale, const Point halfSize) {
+		constexpr Point side = Pivot<P>::corner;
+		const float cornerX = side.x * halfSize.x;
+		const float cornerY = side.y * halfSize.y;
+
+		const float cosine = cos(angle) * scale;
+		const float sine = sin(angle) * scale;
+		const float tx = pos.x - (cosine * cornerX - sine * cornerY);
+		const float ty = pos.y - (sine * cornerX + cosine * cornerY);
+
+		return glm::mat4(
+			glm::vec4(cosine, sine, 0, 0),
+			glm::vec4(-sine, cosine, 0, 0),
+			glm::vec4(0, 0, 1, 0),
+			glm::vec4(tx, ty, 0, 1));
+	}
+
+	// for poses, where the pivot is only known at runtime
+	inline glm::mat4 transform(const ActorPose & pose, const Point halfSize) {
+		switch(pose.pivot) {
+			case PivotSide::LEFT:
+				return transform<PivotSide::LEFT>(pose.pos, pose.angle, pose.scale, halfSize);
+			case PivotSide::RIGHT:
+				return transform<PivotSide::RIGHT>(pose.pos, pose.angle, pose.scale, halfSize);
+			default:
+				return transform<PivotSide::NONE>(pose.pos, pose.angle, pose.scale, halfSize);
+		}
+	}
+
+	// the axis aligned bounding box of a posed shape
+	inline ofRectangle bounds(const ActorPose & pose, const Point halfSize) {
+		glm::mat4 m = transform(pose, halfSize);
+		glm::vec2 min(std::numeric_limits<float>::max());
+		glm::vec2 max(std::numeric_limits<float>::lowest());
+		for(float x: {-halfSize.x, halfSize.x}) {
+			for(float y: {-halfSize.y, halfSize.y}) {
+				glm::vec2 corner(m * glm::vec4(x, y, 0, 1));
+				min = glm::min(min, corner);
+				max = glm::max(max, corner);
+			}
+		}
+		return ofRectangle(min.x, min.y, max.x - min.x, max.y - min.y);
+	}
+}
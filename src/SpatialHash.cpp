@@ -0,0 +1,127 @@
+#include "SpatialHash.h"
+
+SpatialHash::SpatialHash(const float cellSize)
+	: cellSize(cellSize) {
+}
+
+void SpatialHash::clear() {
+	ids.clear();
+	boxes.clear();
+	bucketStart.clear();
+	bucketBoxes.clear();
+}
+
+void SpatialHash::insert(const int id, const ofRectangle & bounds) {
+	ids.push_back(id);
+	boxes.push_back(bounds);
+}
+
+SpatialHash::CellRange SpatialHash::cellsCovering(const ofRectangle & area, const float tolerance) const {
+	CellRange range;
+	range.x0 = static_cast<int>(floor((area.getLeft() - tolerance) / cellSize));
+	range.y0 = static_cast<int>(floor((area.getTop() - tolerance) / cellSize));
+	range.x1 = static_cast<int>(floor((area.getRight() + tolerance) / cellSize));
+	range.y1 = static_cast<int>(floor((area.getBottom() + tolerance) / cellSize));
+	return range;
+}
+
+uint32_t SpatialHash::bucketOf(const int cellX, const int cellY) const {
+	// the table size is a power of two, so the mask picks the bucket
+	uint32_t hash = static_cast<uint32_t>(cellX) * 73856093u ^ static_cast<uint32_t>(cellY) * 19349663u;
+	return hash & (bucketStart.size() - 2);
+}
+
+bool SpatialHash::touches(const ofRectangle & a, const ofRectangle & b, const float tolerance) {
+	return a.getLeft() <= b.getRight() + tolerance && b.getLeft() <= a.getRight() + tolerance
+		&& a.getTop() <= b.getBottom() + tolerance && b.getTop() <= a.getBottom() + tolerance;
+}
+
+void SpatialHash::build() {
+	size_t numEntries = 0;
+	for(const auto & box: boxes) {
+		CellRange range = cellsCovering(box, 0.0f);
+		numEntries += (range.x1 - range.x0 + 1) * (range.y1 - range.y0 + 1);
+	}
+
+	// about twice as many buckets as entries keeps unrelated cells from sharing a bucket
+	size_t numBuckets = 1;
+	while(numBuckets < numEntries * 2) {
+		numBuckets *= 2;
+	}
+	bucketStart.assign(numBuckets + 1, 0);
+	bucketBoxes.resize(numEntries);
+
+	// counting sort: count the entries per bucket, turn the counts into offsets, then fill the buckets in
+	for(const auto & box: boxes) {
+		CellRange range = cellsCovering(box, 0.0f);
+		for(int y = range.y0; y <= range.y1; y++) {
+			for(int x = range.x0; x <= range.x1; x++) {
+				bucketStart[bucketOf(x, y) + 1]++;
+			}
+		}
+	}
+	for(size_t i = 1; i < bucketStart.size(); i++) {
+		bucketStart[i] += bucketStart[i - 1];
+	}
+
+	std::vector<uint32_t> fill(bucketStart.begin(), bucketStart.end() - 1);
+	for(size_t i = 0; i < boxes.size(); i++) {
+		CellRange range = cellsCovering(boxes[i], 0.0f);
+		for(int y = range.y0; y <= range.y1; y++) {
+			for(int x = range.x0; x <= range.x1; x++) {
+				bucketBoxes[fill[bucketOf(x, y)]++] = i;
+			}
+		}
+	}
+
+	seen.assign(boxes.size(), 0);
+	queryStamp = 0;
+}
+
+void SpatialHash::query(const ofRectangle & area, std::vector<int> & result, const float tolerance) const {
+	result.clear();
+	if(boxes.empty() || bucketStart.empty()) {
+		return;
+	}
+
+	queryStamp++;
+	CellRange range = cellsCovering(area, tolerance);
+	for(int y = range.y0; y <= range.y1; y++) {
+		for(int x = range.x0; x <= range.x1; x++) {
+			uint32_t bucket = bucketOf(x, y);
+			for(uint32_t i = bucketStart[bucket]; i < bucketStart[bucket + 1]; i++) {
+				int box = bucketBoxes[i];
+				if(seen[box] != queryStamp && touches(area, boxes[box], tolerance)) {
+					seen[box] = queryStamp;
+					result.push_back(ids[box]);
+				}
+			}
+		}
+	}
+}
+
+void SpatialHash::findContacts(std::vector<std::pair<int, int>> & contacts, const float tolerance) const {
+	contacts.clear();
+	if(boxes.empty() || bucketStart.empty()) {
+		return;
+	}
+
+	for(size_t a = 0; a < boxes.size(); a++) {
+		queryStamp++;
+		CellRange range = cellsCovering(boxes[a], tolerance);
+		for(int y = range.y0; y <= range.y1; y++) {
+			for(int x = range.x0; x <= range.x1; x++) {
+				uint32_t bucket = bucketOf(x, y);
+				for(uint32_t i = bucketStart[bucket]; i < bucketStart[bucket + 1]; i++) {
+					// only look at boxes after this one, so every pair is found once
+					size_t b = bucketBoxes[i];
+					if(b <= a || seen[b] == queryStamp || !touches(boxes[a], boxes[b], tolerance)) {
+						continue;
+					}
+					seen[b] = queryStamp;
+					contacts.emplace_back(std::min(ids[a], ids[b]), std::max(ids[a], ids[b]));
+				}
+			}
+		}
+	}
+}
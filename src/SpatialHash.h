@@ -0,0 +1,43 @@
+#pragma once
+
+#include "ofMain.h"
+
+// A uniform grid over bounding boxes, meant to be rebuilt from scratch every frame.
+// Every box is listed in each cell it touches, and the cells are hashed into a flat table (sorted with a
+// counting sort, so building is O(n)). Queries only look at the boxes in the cells they cover,
+// which keeps contact checks between many actors close to O(n) instead of testing every pair.
+class SpatialHash {
+public:
+	explicit SpatialHash(float cellSize = 128.0f);
+
+	// boxes are collected with insert(), then build() sorts them into cells before querying
+	void clear();
+	void insert(int id, const ofRectangle & bounds);
+	void build();
+
+	// ids of every box touching the area (boxes closer than tolerance count as touching)
+	void query(const ofRectangle & area, std::vector<int> & ids, float tolerance = 0.0f) const;
+
+	// every pair of touching boxes, once each, with the smaller id first
+	void findContacts(std::vector<std::pair<int, int>> & contacts, float tolerance = 0.0f) const;
+
+private:
+	struct CellRange {
+		int x0, y0, x1, y1;
+	};
+	CellRange cellsCovering(const ofRectangle & area, float tolerance) const;
+	uint32_t bucketOf(int cellX, int cellY) const;
+	static bool touches(const ofRectangle & a, const ofRectangle & b, float tolerance);
+
+	float cellSize;
+	std::vector<int> ids;
+	std::vector<ofRectangle> boxes;
+
+	// box indices sorted by bucket, the boxes in bucket b are bucketBoxes[bucketStart[b] .. bucketStart[b + 1]]
+	std::vector<uint32_t> bucketStart;
+	std::vector<int> bucketBoxes;
+
+	// marks boxes already seen in the current query, since a box shows up in every cell it touches
+	mutable std::vector<uint32_t> seen;
+	mutable uint32_t queryStamp = 0;
+};
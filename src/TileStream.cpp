@@ -0,0 +1,253 @@
+#include "TileStream.h"
+#include <zlib.h>
+#include <cstring>
+
+namespace {
+	void putLittleEndian(std::vector<uint8_t> & out, uint32_t value) {
+		out.push_back(value);
+		out.push_back(value >> 8);
+		out.push_back(value >> 16);
+		out.push_back(value >> 24);
+	}
+
+	void writeLittleEndian(std::ofstream & file, uint32_t value) {
+		char bytes[4] = {char(value), char(value >> 8), char(value >> 16), char(value >> 24)};
+		file.write(bytes, 4);
+	}
+
+	bool readLittleEndian(std::ifstream & file, uint32_t & value) {
+		uint8_t bytes[4];
+		if(!file.read(reinterpret_cast<char *>(bytes), 4)) {
+			return false;
+		}
+		value = bytes[0] | bytes[1] << 8 | bytes[2] << 16 | uint32_t(bytes[3]) << 24;
+		return true;
+	}
+
+	// 8 bytes at a time, every step (xor, multiply by an odd constant, xorshift) can be undone,
+	// so changing any single 8 byte word of a tile always changes its hash
+	uint64_t hashTile(const uint8_t * data, size_t stride, size_t rowBytes, int rows) {
+		uint64_t hash = 0x9e3779b97f4a7c15ull;
+		auto mix = [&hash](uint64_t value) {
+			hash = (hash ^ value) * 0xff51afd7ed558ccdull;
+			hash ^= hash >> 33;
+		};
+
+		for(int y = 0; y < rows; y++) {
+			const uint8_t * row = data + y * stride;
+			size_t i = 0;
+			for(; i + 8 <= rowBytes; i += 8) {
+				uint64_t value;
+				memcpy(&value, row + i, 8);
+				mix(value);
+			}
+			if(i < rowBytes) {
+				uint64_t value = 0;
+				memcpy(&value, row + i, rowBytes - i);
+				mix(value);
+			}
+		}
+		return hash;
+	}
+}
+
+bool TileStreamWriter::open(const std::string & path, const int tileSize) {
+	close();
+	this->tileSize = tileSize;
+	stats = Stats();
+	file.open(path, std::ios::binary);
+	return file.is_open();
+}
+
+void TileStreamWriter::writeHeader(const ofPixels & pixels) {
+	width = pixels.getWidth();
+	height = pixels.getHeight();
+	channels = pixels.getNumChannels();
+	tilesX = (width + tileSize - 1) / tileSize;
+	tilesY = (height + tileSize - 1) / tileSize;
+	tileHashes.assign(tilesX * tilesY, 0);
+
+	file.write("TDS1", 4);
+	writeLittleEndian(file, width);
+	writeLittleEndian(file, height);
+	writeLittleEndian(file, channels);
+	writeLittleEndian(file, tileSize);
+	stats.bytesWritten += 20;
+}
+
+size_t TileStreamWriter::addFrame(const ofPixels & pixels) {
+	if(!file.is_open()) {
+		return 0;
+	}
+	if(stats.frames == 0) {
+		writeHeader(pixels);
+	} else if(static_cast<int>(pixels.getWidth()) != width || static_cast<int>(pixels.getHeight()) != height
+		|| static_cast<int>(pixels.getNumChannels()) != channels) {
+		ofLogError("TileStreamWriter") << "frame size changed, skipping the frame";
+		return 0;
+	}
+
+	// collect every tile that isn't the same as last frame (the first frame writes all of them)
+	const size_t stride = width * channels;
+	const uint8_t * data = pixels.getData();
+	payload.clear();
+	uint32_t numTiles = 0;
+	for(int ty = 0; ty < tilesY; ty++) {
+		for(int tx = 0; tx < tilesX; tx++) {
+			int x0 = tx * tileSize;
+			int y0 = ty * tileSize;
+			size_t rowBytes = std::min(tileSize, width - x0) * channels;
+			int rows = std::min(tileSize, height - y0);
+			const uint8_t * tile = data + y0 * stride + x0 * channels;
+
+			int index = ty * tilesX + tx;
+			uint64_t hash = hashTile(tile, stride, rowBytes, rows);
+			if(stats.frames > 0 && hash == tileHashes[index]) {
+				continue;
+			}
+			tileHashes[index] = hash;
+
+			putLittleEndian(payload, index);
+			for(int y = 0; y < rows; y++) {
+				payload.insert(payload.end(), tile + y * stride, tile + y * stride + rowBytes);
+			}
+			numTiles++;
+		}
+	}
+
+	stats.frames++;
+	stats.tilesTotal += tilesX * tilesY;
+	stats.tilesWritten += numTiles;
+	stats.rawBytes += stride * height;
+
+	size_t bytes;
+	if(numTiles == 0) {
+		file.put(TileStream::REPEAT);
+		stats.repeatedFrames++;
+		bytes = 1;
+	} else {
+		uLongf compressedSize = compressBound(payload.size());
+		compressed.resize(compressedSize);
+		compress2(compressed.data(), &compressedSize, payload.data(), payload.size(), Z_BEST_SPEED);
+
+		file.put(TileStream::DELTA);
+		writeLittleEndian(file, numTiles);
+		writeLittleEndian(file, payload.size());
+		writeLittleEndian(file, compressedSize);
+		file.write(reinterpret_cast<const char *>(compressed.data()), compressedSize);
+		bytes = 13 + compressedSize;
+	}
+	stats.bytesWritten += bytes;
+	return bytes;
+}
+
+void TileStreamWriter::close() {
+	if(!file.is_open()) {
+		return;
+	}
+	file.close();
+
+	if(stats.frames > 0) {
+		ofLogNotice("TileStreamWriter") << stats.frames << " frames (" << stats.repeatedFrames << " repeated), "
+			<< 100.0 * stats.tilesWritten / stats.tilesTotal << "% of tiles written, "
+			<< stats.rawBytes / (1024.0 * 1024.0) << " MB of pixels in " << stats.bytesWritten / (1024.0 * 1024.0) << " MB";
+	}
+}
+
+bool TileStreamReader::open(const std::string & path) {
+	close();
+	file.open(path, std::ios::binary);
+
+	char magic[4];
+	uint32_t header[4];
+	if(!file.read(magic, 4) || memcmp(magic, "TDS1", 4) != 0) {
+		ofLogError("TileStreamReader") << path << " is not a tile stream";
+		close();
+		return false;
+	}
+	for(auto & value: header) {
+		if(!readLittleEndian(file, value)) {
+			close();
+			return false;
+		}
+	}
+
+	width = header[0];
+	height = header[1];
+	channels = header[2];
+	tileSize = header[3];
+	if(tileSize == 0) {
+		close();
+		return false;
+	}
+	tilesX = (width + tileSize - 1) / tileSize;
+	return true;
+}
+
+void TileStreamReader::close() {
+	if(file.is_open()) {
+		file.close();
+	}
+	file.clear();
+}
+
+bool TileStreamReader::readFrame(ofPixels & pixels) {
+	int type = file.get();
+	if(type == EOF) {
+		return false;
+	}
+
+	if(pixels.getWidth() != static_cast<size_t>(width) || pixels.getHeight() != static_cast<size_t>(height)
+		|| pixels.getNumChannels() != static_cast<size_t>(channels)) {
+		pixels.allocate(width, height, channels);
+	}
+	if(type == TileStream::REPEAT) {
+		return true;
+	}
+
+	uint32_t numTiles, payloadSize, compressedSize;
+	if(type != TileStream::DELTA || !readLittleEndian(file, numTiles) || !readLittleEndian(file, payloadSize)
+		|| !readLittleEndian(file, compressedSize)) {
+		return false;
+	}
+	compressed.resize(compressedSize);
+	if(!file.read(reinterpret_cast<char *>(compressed.data()), compressedSize)) {
+		return false;
+	}
+	payload.resize(payloadSize);
+	uLongf size = payloadSize;
+	if(uncompress(payload.data(), &size, compressed.data(), compressedSize) != Z_OK || size != payloadSize) {
+		return false;
+	}
+
+	// copy every changed tile over the previous frame
+	const size_t stride = width * channels;
+	const int numTilesTotal = tilesX * ((height + tileSize - 1) / tileSize);
+	uint8_t * data = pixels.getData();
+	size_t pos = 0;
+	for(uint32_t i = 0; i < numTiles; i++) {
+		if(pos + 4 > payload.size()) {
+			return false;
+		}
+		uint32_t index = payload[pos] | payload[pos + 1] << 8 | payload[pos + 2] << 16 | uint32_t(payload[pos + 3]) << 24;
+		pos += 4;
+		if(index >= static_cast<uint32_t>(numTilesTotal)) {
+			return false;
+		}
+
+		int x0 = (index % tilesX) * tileSize;
+		int y0 = (index / tilesX) * tileSize;
+		size_t rowBytes = std::min(tileSize, width - x0) * channels;
+		int rows = std::min(tileSize, height - y0);
+		if(pos + rowBytes * rows > payload.size()) {
+			return false;
+		}
+
+		uint8_t * tile = data + y0 * stride + x0 * channels;
+		for(int y = 0; y < rows; y++) {
+			memcpy(tile + y * stride, payload.data() + pos, rowBytes);
+			pos += rowBytes;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "ofMain.h"
+
+// A frame stream that only stores what changed. Every frame is split into tiles and each tile is hashed;
+// only the tiles whose hash differs from the previous frame are written (deflated together), and a frame
+// where nothing changed is a single "repeat" record. Most of this animation is static background, and it
+// holds still for the credits and after c = 35, so most frames come out tiny.
+//
+// File layout, little endian:
+//   header: "TDS1", width, height, channels, tile size (uint32 each)
+//   frames: one type byte each, REPEAT has nothing after it, DELTA is followed by
+//           the number of tiles, the uncompressed size and the compressed size (uint32 each), then the
+//           deflated tiles, each one a uint32 tile index followed by its rows of pixels
+namespace TileStream {
+	enum RecordType : uint8_t {
+		REPEAT = 0,
+		DELTA = 1
+	};
+}
+
+class TileStreamWriter {
+public:
+	struct Stats {
+		int frames = 0;
+		int repeatedFrames = 0;
+		size_t tilesWritten = 0;
+		size_t tilesTotal = 0;
+		size_t rawBytes = 0;
+		size_t bytesWritten = 0;
+	};
+
+	// the header is written with the first frame, once the frame size is known
+	bool open(const std::string & path, int tileSize = 32);
+	// returns the number of bytes written for this frame
+	size_t addFrame(const ofPixels & pixels);
+	void close();
+
+	bool isOpen() const { return file.is_open(); }
+	const Stats & getStats() const { return stats; }
+
+private:
+	void writeHeader(const ofPixels & pixels);
+
+	std::ofstream file;
+	int tileSize = 32;
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	int tilesX = 0;
+	int tilesY = 0;
+	std::vector<uint64_t> tileHashes;
+	std::vector<uint8_t> payload;
+	std::vector<uint8_t> compressed;
+	Stats stats;
+};
+
+class TileStreamReader {
+public:
+	bool open(const std::string & path);
+	void close();
+
+	// updates pixels to the next frame (they have to hold the previous frame), false at the end of the stream
+	bool readFrame(ofPixels & pixels);
+
+	bool isOpen() const { return file.is_open(); }
+	int getWidth() const { return width; }
+	int getHeight() const { return height; }
+	int getNumChannels() const { return channels; }
+
+private:
+	std::ifstream file;
+	int tileSize = 0;
+	int width = 0;
+	int height = 0;
+	int channels = 0;
+	int tilesX = 0;
+	std::vector<uint8_t> payload;
+	std::vector<uint8_t> compressed;
+};
@@ -1,8 +1,11 @@
 #include "ofApp.h"
+#include "Shapes.h"
 
 //--------------------------------------------------------------
 void ofApp::setup() {
 	c = 0;
+	screenWidth = ofGetWidth();
+	screenHeight = ofGetHeight();
 
 	// define the windows in the background
 	windows.push_back({ofRectangle(0, 170, 358, 237)});
@@ -25,12 +28,14 @@ void ofApp::setup() {
 		}
 	}
 
-	font.load("../../src/HelveticaNeue.ttf", 32);
+	// keep the windows grouped by pivot side, drawBackground() draws each group with its own transform
+	std::stable_sort(windows.begin(), windows.end(), [](const Window & a, const Window & b) { return a.pivotSide < b.pivotSide; });
+
+	// with contours, so the export can rasterize the glyph outlines
+	font.load("../../src/HelveticaNeue.ttf", 32, true, true, true);
 
 	// initialize helper variables
-	rectanglePos = glm::vec2(-200, 600);
-	rectangleAngle = 0;
-	crescentAngle = 0;
+	resetAnimationState();
 
 	// initialize the trapezoid fall animation
 	glm::vec2 startPos(1276, 525 - 45);
@@ -113,39 +118,302 @@ void ofApp::setup() {
 		rectStart = nextPos;
 	}
 
+	// everything is deterministic from here on, so bake the whole timeline (0 to 37 seconds, 100 samples per second,
+	// more where the motion is too fast for the playback to stay within half a pixel)
+	motionCache.bake([this](SceneState & state) { evaluate(state); }, [this] { resetAnimationState(); }, 37.0f, 100.0f, 0.5f);
+	resetAnimationState();
+
+	const MotionCache::Report & report = motionCache.getReport();
+	ofLogNotice("MotionCache") << report.numSamples << " samples (" << report.numSplitSegments << " segments split), "
+		<< report.bytes / 1024.0f << " KB, "
+		<< "max error: " << report.positionError << " px (" << report.quantizationError << " px quantization), "
+		<< report.angleError << " rad, " << report.scaleError << " scale, " << report.numCuts << " cuts";
+
+	startPipeline();
+}
+
+//--------------------------------------------------------------
+void ofApp::exit() {
+	stopPipeline();
+}
+
+// the helper variables carry over from frame to frame, so they need to be reset before running the timeline from the start
+void ofApp::resetAnimationState() {
+	crescentAngle = 0;
+	crescentPerch = glm::vec2(-200, 600 - 200 - 15); // where the rectangle's head will be once it walks in
+	lastLandingTime = -std::numeric_limits<float>::infinity();
+	rectangleOnGround = true; // not in the air, so the first frame with it on the ground isn't a landing
+	crescentParent = -1;
+	spatialHash.clear();
+}
+
+// the timeline carries state over from frame to frame (who the crescent rides on, the last landing),
+// so jumping to another time means running it from the start up to there
+void ofApp::replayTimeline(const float time) {
+	resetAnimationState();
+	SceneState state;
+	for(int frame = 0; frame * timeStep < time; frame++) {
+		state.c = frame * timeStep;
+		evaluate(state);
+	}
 }
 
 //--------------------------------------------------------------
 void ofApp::update() {
-	c += 0.005f; // counter goes up
+	// with the pipeline, the worker thread keeps the time, and the animation waits while a stream plays back
+	if(!pipelineRunning && !playback.isOpen()) {
+		c += timeStep; // counter goes up
+	}
 	// cout << c << "\n";
 }
 
 //--------------------------------------------------------------
 void ofApp::draw() {
+	// playing back an exported stream, each frame is the last one with the changed tiles copied over it
+	if(playback.isOpen()) {
+		if(playback.readFrame(playbackPixels)) {
+			playbackTexture.loadData(playbackPixels);
+			playbackTexture.draw(0, 0);
+			return;
+		}
+		playback.close();
+	}
+
+	const SceneState * state = &scene;
+	if(pipelineRunning) {
+		// this frame was evaluated on the worker thread while the last one was being drawn
+		state = sceneHandoff.read(pipelineRunning);
+		c = state->c;
+	} else {
+		scene.c = c;
+		if(useMotionCache && motionCache.isBaked()) {
+			motionCache.sample(c, scene);
+		} else {
+			evaluate(scene);
+		}
+	}
+
+	if(!exporter.isRunning()) {
+		drawScene(*state);
+		return;
+	}
+
+	// exporting, rasterize the frame on the cpu so it goes straight to the encoders without a readback, then show it
+	rasterizeScene(*state, exportPixels);
+	exportTexture.loadData(exportPixels);
+	exporter.addFrame(exportPixels);
+	exportTexture.draw(0, 0);
+
+	// keep "The End" on screen for a second
+	if(c > 38.0f) {
+		stopExport();
+	}
+}
+
+// runs evaluation on its own thread, from the current time on
+void ofApp::startPipeline() {
+	if(pipelineRunning) {
+		return;
+	}
+	sceneHandoff.reset();
+	seekRequested = false;
+	pipelineRunning = true;
+	evaluationThread = std::thread(&ofApp::evaluateLoop, this, c); // c belongs to the main thread, the worker gets a copy
+}
+
+// back to evaluating and drawing one after the other on the main thread
+void ofApp::stopPipeline() {
+	if(!pipelineRunning) {
+		return;
+	}
+	pipelineRunning = false;
+	sceneHandoff.wake(); // the worker may be asleep waiting for draw() to take a frame
+	evaluationThread.join();
+}
+
+// the worker thread: evaluates frame N + 1 into one buffer while draw() draws frame N from the other one
+void ofApp::evaluateLoop(float time) {
+	while(true) {
+		SceneState * state = sceneHandoff.beginWrite(pipelineRunning);
+		if(state == nullptr) {
+			return;
+		}
+
+		// the m key asks for a replay before it switches to live evaluation, so reading the switch first
+		// means a frame evaluated live always sees the replay it needs
+		bool cached = useMotionCache && motionCache.isBaked();
+		if(seekRequested.exchange(false)) {
+			time = seekTime;
+			replayTimeline(time);
+		}
+		time += timeStep;
+
+		state->c = time;
+		if(cached) {
+			motionCache.sample(time, *state);
+		} else {
+			evaluate(*state);
+		}
+		sceneHandoff.publish();
+	}
+}
+
+// exports every frame from the start of the animation into data/export
+void ofApp::startExport(const FrameCodec codec) {
+	// the worker thread owns the animation state while it runs, so restart it from the beginning too
+	bool pipelined = pipelineRunning;
+	stopPipeline();
+	c = 0;
+	resetAnimationState();
+	if(pipelined) {
+		startPipeline();
+	}
+
+	// don't wait for vsync, the export runs as fast as the encoders can keep up
+	ofSetVerticalSync(false);
+	ofSetFrameRate(0);
+	exporter.start(ofToDataPath("export", true), codec);
+}
+
+void ofApp::stopExport() {
+	FrameExporter::Report report = exporter.stop();
+	ofSetVerticalSync(true);
+	ofSetFrameRate(60);
+
+	ofLogNotice("FrameExporter") << report.frames << " frames in " << report.seconds << " s: "
+		<< report.framesPerSecond << " frames/s, " << report.megabytesPerSecond << " MB/s, "
+		<< report.encodedBytes / (1024.0 * 1024.0) << " MB written";
+}
+
+// runs the timelines at state.c, the characters that aren't on screen stay invisible
+void ofApp::evaluate(SceneState & state) {
+	state.trapezoid.visible = false;
+	state.rectangle.visible = false;
+	state.crescent.visible = false;
+
+	// credits, nothing is animated yet
+	if(state.c < 3.0f) {
+		return;
+	}
+
+	// animate each part
+	animateBackground(state);
+	animateRectangle(state);
+	animateTrapezoid(state);
+	animateCrescent(state);
+
+	// find out what touches what, the next frame reacts to it
+	updateContacts(state);
+}
+
+// rebuilds the spatial hash from where everything ended up this frame and looks for the rectangle landing
+void ofApp::updateContacts(const SceneState & state) {
+	spatialHash.clear();
+	if(state.trapezoid.visible) {
+		spatialHash.insert(static_cast<int>(Actor::TRAPEZOID), Shapes::bounds(state.trapezoid, Shapes::Trapezoid::halfSize));
+	}
+	if(state.rectangle.visible) {
+		spatialHash.insert(static_cast<int>(Actor::RECTANGLE), Shapes::bounds(state.rectangle, Shapes::Rectangle::halfSize));
+	}
+	if(state.crescent.visible) {
+		spatialHash.insert(static_cast<int>(Actor::CRESCENT), Shapes::bounds(state.crescent, Shapes::Crescent::halfSize));
+	}
+	spatialHash.insert(static_cast<int>(Actor::GROUND), ofRectangle(-screenWidth, groundY, screenWidth * 3, screenHeight));
+	spatialHash.build();
+
+	// within a pixel counts as touching, the rectangle moves a few pixels per frame right before it lands
+	spatialHash.findContacts(contacts, 1.0f);
+	auto landed = std::make_pair(static_cast<int>(Actor::RECTANGLE), static_cast<int>(Actor::GROUND));
+	bool onGround = std::find(contacts.begin(), contacts.end(), landed) != contacts.end();
+	if(onGround && !rectangleOnGround) {
+		lastLandingTime = state.c;
+	}
+	// it only lands if it was in the air last frame, showing up on the ground doesn't count
+	rectangleOnGround = onGround || !state.rectangle.visible;
+}
+
+// the crescent rides on a character: once it has one it follows that character's pose every frame, until then
+// it looks in last frame's spatial hash for one just under its perch, and takes the one with the highest top
+// returns the parent's pose, or nullptr if it isn't riding anything and the perch stays where it was
+const ActorPose * ofApp::attachCrescent(const SceneState & state) {
+	// the characters it can ride on, it can't ride on itself or the ground
+	auto rideable = [&state](const int id, Shapes::Point & halfSize) -> const ActorPose * {
+		if(id == static_cast<int>(Actor::RECTANGLE)) {
+			halfSize = Shapes::Rectangle::halfSize;
+			return &state.rectangle;
+		}
+		if(id == static_cast<int>(Actor::TRAPEZOID)) {
+			halfSize = Shapes::Trapezoid::halfSize;
+			return &state.trapezoid;
+		}
+		return nullptr;
+	};
+
+	Shapes::Point halfSize;
+	const ActorPose * parent = rideable(crescentParent, halfSize);
+	if(parent != nullptr && !parent->visible) {
+		parent = nullptr; // it left the screen, look for a new one
+	}
+
+	if(parent == nullptr) {
+		// within reach of the crescent sitting on its perch, the rectangle bobs up to 30 px under it while it walks in
+		const Shapes::Point crescentSize = Shapes::Crescent::halfSize;
+		ofRectangle perched(crescentPerch.x - crescentSize.x, crescentPerch.y - crescentSize.y, crescentSize.x * 2, crescentSize.y * 2);
+		spatialHash.query(perched, nearbyActors, 40.0f);
+
+		float parentTop = std::numeric_limits<float>::max();
+		for(int id: nearbyActors) {
+			Shapes::Point size;
+			const ActorPose * pose = rideable(id, size);
+			// the top of the shape ignoring its rotation, so the crescent stays centred on its head when it tilts
+			if(pose != nullptr && pose->visible && pose->pos.y - size.y * pose->scale < parentTop) {
+				parent = pose;
+				parentTop = pose->pos.y - size.y * pose->scale;
+				halfSize = size;
+				crescentParent = id;
+			}
+		}
+	}
+
+	if(parent == nullptr) {
+		crescentParent = -1;
+		return nullptr;
+	}
+	crescentPerch = glm::vec2(parent->pos.x, parent->pos.y - halfSize.y * parent->scale - Shapes::Crescent::halfSize.y);
+	return parent;
+}
+
+void ofApp::drawScene(const SceneState & state) {
 
 	// start of animation, show credits
-	if(c < 3.0f) {
-		ofSetBackgroundColor(0);
+	// (ofBackground() also clears, so this works the same when drawing into the export fbo)
+	if(state.c < 3.0f) {
+		ofBackground(0);
 		ofSetColor(255);
 		font.drawString("Hendry Hu", 300, 300);
 		font.drawString("A short animation featuring some shapes.", 300, 350);
-		font.drawString(ofToString(c, 2), 10, 30);
+		font.drawString(ofToString(state.c, 2), 10, 30);
 		return;
 	}
 
-	// animate each part
-	animateBackground();
-	animateRectangle();
-	animateTrapezoid();
-	animateCrescent();
+	// draw each part
+	drawBackground(state.windowTilt, state.timeOfDay);
+	if(state.rectangle.visible) {
+		drawRectangle(state.rectangle);
+	}
+	if(state.trapezoid.visible) {
+		drawTrapezoid(state.trapezoid);
+	}
+	if(state.crescent.visible) {
+		drawCrescent(state.crescent);
+	}
 
 	// display the time counter in the top left corner
 	ofSetColor(255);
-	font.drawString(ofToString(c, 2), 10, 30);
+	font.drawString(ofToString(state.c, 2), 10, 30);
 
 	// if it's the end, show "The End"
-	if(c > 37.0f) {
+	if(state.c > 37.0f) {
 		ofSetColor(0, 150);
 		ofSetColor(255);
 		font.drawString("The End", ofGetWidth() / 2 - 70, ofGetHeight() / 2 + 10);
@@ -153,82 +421,104 @@ void ofApp::draw() {
 
 }
 
-// functions to draw static 2d characters
-void ofApp::drawTrapezoid(const glm::vec2 pos, const float angle, const PivotSide pivot, float scale) {
-	ofSetColor(ofColor::darkGreen);
-	ofPushMatrix();
-	ofTranslate(pos);
+// the same frame as drawScene(), drawn into pixels on the cpu with analytic coverage instead of multisampling (see Rasterizer.h)
+void ofApp::rasterizeScene(const SceneState & state, ofPixels & pixels) {
+	const ofColor white(255);
 
-	if(pivot == PivotSide::NONE) {
-		ofRotateRad(angle);
+	if(state.c < 3.0f) {
+		rasterizer.begin(pixels, ofGetWidth(), ofGetHeight(), ofColor(0));
+		rasterizer.fillText(font, "Hendry Hu", 300, 300, white);
+		rasterizer.fillText(font, "A short animation featuring some shapes.", 300, 350, white);
+		rasterizer.fillText(font, ofToString(state.c, 2), 10, 30, white);
+		return;
 	}
 
-	// if we have a pivot, then translate to the pivot point first before rotating
-	else {
-		glm::vec2 localCorner;
-		if(pivot == PivotSide::LEFT) {
-			localCorner = glm::vec2(-50, 45);
-		} else {
-			localCorner = glm::vec2(50, 45);
-		}
-		ofRotateRad(-angle);  // I genuinely have no idea why this needs to be negative
-		ofTranslate(-localCorner);
+	rasterizer.begin(pixels, ofGetWidth(), ofGetHeight(), ofColor(118, 136, 155));
+	ofColor bgColor = bgColorNight.getLerped(bgColorDay, state.timeOfDay);
+	forEachWindow(state.windowTilt, [this, &bgColor](const Shapes::Point halfSize, const glm::mat4 & transform) {
+		const Shapes::Point corners[4] = {{-halfSize.x, -halfSize.y}, {halfSize.x, -halfSize.y}, {halfSize.x, halfSize.y}, {-halfSize.x, halfSize.y}};
+		rasterizer.fillPolygon(corners, 4, transform, bgColor);
+	});
+
+	const ActorPose & rectangle = state.rectangle;
+	if(rectangle.visible) {
+		rasterizer.fillPolygon(Shapes::Rectangle::vertices, 4,
+			Shapes::transform<PivotSide::NONE>(rectangle.pos, rectangle.angle, rectangle.scale, Shapes::Rectangle::halfSize), rectangle.color);
+	}
+	if(state.trapezoid.visible) {
+		rasterizer.fillPolygon(Shapes::Trapezoid::vertices, 4, Shapes::transform(state.trapezoid, Shapes::Trapezoid::halfSize), state.trapezoid.color);
+	}
+	const ActorPose & crescent = state.crescent;
+	if(crescent.visible) {
+		rasterizer.fillPolygon(Shapes::crescentOutline(),
+			Shapes::transform<PivotSide::NONE>(crescent.pos, crescent.angle, crescent.scale, Shapes::Crescent::halfSize), crescent.color);
 	}
 
-	ofScale(scale);
+	rasterizer.fillText(font, ofToString(state.c, 2), 10, 30, white);
+	if(state.c > 37.0f) {
+		rasterizer.fillText(font, "The End", ofGetWidth() / 2 - 70, ofGetHeight() / 2 + 10, white);
+	}
+}
 
-	ofDrawTriangle(glm::vec2(-40, -45), glm::vec2(40, -45), glm::vec2(50, 45));
-	ofDrawTriangle(glm::vec2(-40, -45), glm::vec2(-50, 45), glm::vec2(50, 45));
+// functions to draw static 2d characters
+void ofApp::drawTrapezoid(const ActorPose & pose) {
+	ofSetColor(pose.color);
+	ofPushMatrix();
+	ofMultMatrix(Shapes::transform(pose, Shapes::Trapezoid::halfSize));
+
+	const auto & v = Shapes::Trapezoid::vertices;
+	ofDrawTriangle(v[0], v[1], v[2]);
+	ofDrawTriangle(v[0], v[3], v[2]);
 
 	ofPopMatrix();
 }
 
-void ofApp::drawRectangle(const glm::vec2 pos, const float angle, const float timeOfDay, float scale) {
-	// keep a copy of the position and angle for the crescent to use
-	rectangleAngle = angle;
-	rectanglePos = pos;
-
-	ofColor rectColor = rectNormalColor.getLerped(rectNightColor, timeOfDay);
-	ofSetColor(rectColor);
+void ofApp::drawRectangle(const ActorPose & pose) {
+	ofSetColor(pose.color);
 	ofPushMatrix();
-	ofTranslate(pos);
-	ofRotateRad(angle);
-	ofScale(scale);
-	ofDrawRectangle(-120, -200, 240, 400);  // height 400, width 240
+	ofMultMatrix(Shapes::transform<PivotSide::NONE>(pose.pos, pose.angle, pose.scale, Shapes::Rectangle::halfSize));
+	const Shapes::Point half = Shapes::Rectangle::halfSize;
+	ofDrawRectangle(-half.x, -half.y, half.x * 2, half.y * 2);  // height 400, width 240
 	ofPopMatrix();
 }
 
-void ofApp::drawCrescent(const glm::vec2 pos, const float angle) {
-	ofSetColor(ofColor::lightGoldenRodYellow);
+void ofApp::drawCrescent(const ActorPose & pose) {
+	ofSetColor(pose.color);
 	ofPushMatrix();
-	ofTranslate(pos);
-	ofRotateRad(angle);
+	ofMultMatrix(Shapes::transform<PivotSide::NONE>(pose.pos, pose.angle, pose.scale, Shapes::Crescent::halfSize));
 
 	// the crescent is made of two arcs, one on top of the other
 	ofBeginShape();
-	float moonWidth = 60;
-	float moonHeight = 30;
-	float innerArcHeight = 16;
-	int resolution = 16;
-
-	// Top edge
-	for(int i = 0; i <= resolution; i++) {
-		float moonAngle = ofMap(i, 0, resolution, PI, 0);
-		float x = (moonWidth / 2) + (moonWidth / 2) * cos(moonAngle);
-		float y = moonHeight * sin(moonAngle);
-		ofVertex(x, -y);
+	for(const auto & point: Shapes::crescentOutline()) {
+		ofVertex(point);
 	}
-
-	// Bottom edge, going backwards to close the shape
-	for(int i = resolution; i >= 0; i--) {
-		float moonAngle = ofMap(i, 0, resolution, PI, 0);
-		float x = (moonWidth / 2) + (moonWidth / 2) * cos(moonAngle);
-		float y = innerArcHeight * sin(moonAngle);
-		ofVertex(x, -y);
-	}
-	ofTranslate(-moonWidth / 2, moonHeight / 2);
 	ofEndShape(true);
 	ofPopMatrix();
+}
+
+// functions to place the characters, the animations only decide where things go and drawScene() draws them later
+void ofApp::poseTrapezoid(SceneState & state, const glm::vec2 pos, const float angle, const PivotSide pivot, float scale) {
+	state.trapezoid.visible = true;
+	state.trapezoid.pos = pos;
+	state.trapezoid.angle = angle;
+	state.trapezoid.scale = scale;
+	state.trapezoid.pivot = pivot;
+	state.trapezoid.color = ofColor::darkGreen;
+}
+
+void ofApp::poseRectangle(SceneState & state, const glm::vec2 pos, const float angle, const float timeOfDay, float scale) {
+	state.rectangle.visible = true;
+	state.rectangle.pos = pos;
+	state.rectangle.angle = angle;
+	state.rectangle.scale = scale;
+	state.rectangle.color = rectNormalColor.getLerped(rectNightColor, timeOfDay);
+}
+
+void ofApp::poseCrescent(SceneState & state, const glm::vec2 pos, const float angle) {
+	state.crescent.visible = true;
+	state.crescent.pos = pos;
+	state.crescent.angle = angle;
+	state.crescent.color = ofColor::lightGoldenRodYellow;
 
 	// keep a copy of the angle for the background to use
 	crescentAngle = angle / (2 * PI);
@@ -236,7 +526,9 @@ void ofApp::drawCrescent(const glm::vec2 pos, const float angle) {
 
 // functions to animate the characters
 // the "timeline" for the trapezoid
-void ofApp::animateTrapezoid() {
+void ofApp::animateTrapezoid(SceneState & state) {
+	const float c = state.c;
+
 	// trapezoid rocks back and forth on the windowsill
 	if(c > 3.0f && c < 13.5f) {
 		float seqTime = c - 3.0f;
@@ -246,17 +538,19 @@ void ofApp::animateTrapezoid() {
 		glm::vec2 leftPivotWorld(1276 - 50, 525);
 		glm::vec2 rightPivotWorld(1276 + 50, 525);
 
-		if(angle > 0) { // Tilting right, pivot on the bottom left
-			drawTrapezoid(leftPivotWorld, angle, PivotSide::LEFT);
-		} else { // Tilting left, pivot on the bottom right
-			drawTrapezoid(rightPivotWorld, angle, PivotSide::RIGHT);
+		// the rocking angle counts counter-clockwise, but on screen y points down so positive angles turn clockwise,
+		// that's why it's flipped when posing the trapezoid
+		if(angle > 0) { // Leaning left, pivot on the bottom left
+			poseTrapezoid(state, leftPivotWorld, -angle, PivotSide::LEFT);
+		} else { // Leaning right, pivot on the bottom right
+			poseTrapezoid(state, rightPivotWorld, -angle, PivotSide::RIGHT);
 		}
 	}
 
 	// trapezoid is still on the windowsill
 	if(c >= 13.5f && c < 15.0f) {
 		glm::vec2 basePos(1276, 525 - 45);
-		drawTrapezoid(basePos, 0);
+		poseTrapezoid(state, basePos, 0);
 	}
 
 	// trapezoid jumps up and down rapidly on the windowsill
@@ -268,25 +562,26 @@ void ofApp::animateTrapezoid() {
 		float jumpHeight = 60.0f;
 		glm::vec2 basePos(1276, 525 - 45);
 		glm::vec2 jumpPos(basePos.x, basePos.y - jumpProgress * jumpHeight);
-		drawTrapezoid(jumpPos, 0);
+		poseTrapezoid(state, jumpPos, 0);
 	}
 
 	// trapezoid is still on the windowsill, reacts with rectangle's landing by going up and down a bit
 	if(c >= 16.0f && c < 20.0f) {
 		glm::vec2 basePos(1276, 525 - 45);
 
-		// rectangle lands at c = 18, c = 19 (ignore c = 20, as it will do its custom falling thingy)
+		// reacts whenever the rectangle touches down on the ground, which happens at c = 18, c = 19
+		// (ignore c = 20, as it will do its custom falling thingy)
 		// motion takes 0.4 seconds
-		if((c >= 18.0f && c < 18.4f) || (c >= 19.0f && c < 19.4f)) {
-			float impactTime = fmod(c, 1.0f); // time since last whole second
+		float impactTime = c - lastLandingTime; // time since the rectangle landed
+		if(impactTime >= 0.0f && impactTime < 0.4f) {
 			float impactProgress = ofMap(impactTime, 0.0f, 0.4f, 0.0f, 1.0f);
 			float easedImpact = sin(impactProgress * PI); // easing
 
 			float impactHeight = 15.0f;
 			glm::vec2 impactPos(basePos.x, basePos.y - easedImpact * impactHeight);
-			drawTrapezoid(impactPos, 0);
+			poseTrapezoid(state, impactPos, 0);
 		} else {
-			drawTrapezoid(basePos, 0);
+			poseTrapezoid(state, basePos, 0);
 		}
 	}
 
@@ -319,13 +614,13 @@ void ofApp::animateTrapezoid() {
 		// Scale up to 2x size while falling
 		float scale = ofMap(seqTime, 0.0, 2.0, 1.0, 2.0f);
     
-		drawTrapezoid(positionAtLine, angle, PivotSide::NONE, scale);
+		poseTrapezoid(state, positionAtLine, angle, PivotSide::NONE, scale);
 	}
 
 	// trapezoid is on the ground
 	if(c >= 22.0f && c < 34.0f) {
 		glm::vec2 finalPos = glm::vec2(trapezoidFallAnimation.getPointAtPercent(1.0f).x, trapezoidFallAnimation.getPointAtPercent(1.0f).y);
-		drawTrapezoid(finalPos, 0, PivotSide::NONE, 2.0f);
+		poseTrapezoid(state, finalPos, 0, PivotSide::NONE, 2.0f);
 	}
 
 	// move towards the middle
@@ -334,20 +629,22 @@ void ofApp::animateTrapezoid() {
 		float progress = seqTime / 1.0f;
 		float easedProgress = progress * progress * (3.0f - 2.0f * progress); // smoothstep
 		glm::vec2 startPos = glm::vec2(trapezoidFallAnimation.getPointAtPercent(1.0f).x, trapezoidFallAnimation.getPointAtPercent(1.0f).y);
-		glm::vec2 targetPos = glm::vec2(ofGetWidth() / 2, trapezoidFallAnimation.getPointAtPercent(1.0f).y);
+		glm::vec2 targetPos = glm::vec2(screenWidth / 2, trapezoidFallAnimation.getPointAtPercent(1.0f).y);
 		glm::vec2 newPos = glm::vec2(ofLerp(startPos.x, targetPos.x, easedProgress), ofLerp(startPos.y, targetPos.y, easedProgress));
-		drawTrapezoid(newPos, 0, PivotSide::NONE, 2.0f);
+		poseTrapezoid(state, newPos, 0, PivotSide::NONE, 2.0f);
 	}
 
 	// stays there forever
 	if(c >= 35.0f) {
-		glm::vec2 finalPos = glm::vec2(ofGetWidth() / 2, trapezoidFallAnimation.getPointAtPercent(1.0f).y);
-		drawTrapezoid(finalPos, 0, PivotSide::NONE, 2.0f);
+		glm::vec2 finalPos = glm::vec2(screenWidth / 2, trapezoidFallAnimation.getPointAtPercent(1.0f).y);
+		poseTrapezoid(state, finalPos, 0, PivotSide::NONE, 2.0f);
 	}
 }
 
 // the "timeline" for the rectangle
-void ofApp::animateRectangle() {
+void ofApp::animateRectangle(SceneState & state) {
+	const float c = state.c;
+
 	// rectangle walks in from the left, pauses a bit in front of the trapezoid
 	if(c > 5.0f && c < 10.0f) {
 		float seqTime = c - 5.0f;
@@ -368,7 +665,7 @@ void ofApp::animateRectangle() {
 		angleNoise = ofDegToRad(ofMap(angleNoise, 0.0f, 1.0f, 0.0f, 30.0f));
 		angleNoise *= (1.0f - easedProgress);
 
-		drawRectangle(bobbedPos, angleNoise);
+		poseRectangle(state, bobbedPos, angleNoise);
 	}
 
 	// rectangle just bobs up and down in front of the trapezoid
@@ -390,7 +687,7 @@ void ofApp::animateRectangle() {
 		}
 
 		glm::vec2 bobbedPos(basePos.x, basePos.y + bobNoise);
-		drawRectangle(bobbedPos, 0);
+		poseRectangle(state, bobbedPos, 0);
 	}
 
 	// rectangle jumps up and down slowly
@@ -401,13 +698,13 @@ void ofApp::animateRectangle() {
 		float jumpHeight = 60.0f;
 		glm::vec2 basePos(800, 600);
 		glm::vec2 jumpPos(basePos.x, basePos.y - jumpProgress * jumpHeight);
-		drawRectangle(jumpPos, 0);
+		poseRectangle(state, jumpPos, 0);
 	}
 
 	// rectangle stays still
 	if(c >= 20.0f && c < 31.0f) {
 		glm::vec2 basePos(800, 600);
-		drawRectangle(basePos, 0);
+		poseRectangle(state, basePos, 0);
 	}
 
 	// rectangle follows the path and becomes big
@@ -421,38 +718,46 @@ void ofApp::animateRectangle() {
 		// slowly rotate to 90 degrees
 		float angle = ofMap(progress, 0.0, 1.0, 0, PI / 2.0f);
 
-		drawRectangle(positionAtLine, angle, progress, 1 + progress * 3.0f);
+		poseRectangle(state, positionAtLine, angle, progress, 1 + progress * 3.0f);
 	}
 
 	// rectangle stays still at (0,0)
 	if(c > 34.0f) {
-		drawRectangle(glm::vec2(0, 0), PI / 2.0f, 1.0f, 10.0f);
+		poseRectangle(state, glm::vec2(0, 0), PI / 2.0f, 1.0f, 10.0f);
 	}
 }
 
 // the "timeline" for the crescent
-void ofApp::animateCrescent() {
+void ofApp::animateCrescent(SceneState & state) {
+	const float c = state.c;
+
+	// it rides on the rectangle's head until it flies off at c = 30
+	const ActorPose * parent = nullptr;
+	if(c < 30.5f) {
+		parent = attachCrescent(state);
+	}
+
 	// jump up and down on top of the rectangle
 	if(c > 3.0f && c < 10.0f) {
 		float seqTime = c - 3.0f;
 		float jumpProgress = abs(sin(seqTime * PI));
 
 		// it needs to follow the rectangle's head
-		float basePosX = rectanglePos.x;
-		float basePosY = rectanglePos.y - 200 - 15;
+		float basePosX = crescentPerch.x;
+		float basePosY = crescentPerch.y;
 		float jumpHeight = 60.0f;
 		glm::vec2 jumpPos(basePosX, basePosY - jumpProgress * jumpHeight);
 
-		float angle = rectangleAngle;  // tilt with the rectangle
-		drawCrescent(jumpPos, angle);
+		float angle = parent != nullptr ? parent->angle : 0.0f;  // tilt with the rectangle
+		poseCrescent(state, jumpPos, angle);
 	}
 
 	// stays still for a bit on top of the rectangle
 	if(c >= 10.0f && c < 12.0f) {
-		float basePosX = rectanglePos.x;
-		float basePosY = rectanglePos.y - 200 - 15;
+		float basePosX = crescentPerch.x;
+		float basePosY = crescentPerch.y;
 		glm::vec2 basePos(basePosX, basePosY);
-		drawCrescent(basePos, 0);
+		poseCrescent(state, basePos, 0);
 	}
 
 	// jumps up and down rapidly on top of the rectangle
@@ -461,30 +766,30 @@ void ofApp::animateCrescent() {
 		float seqTime = c - 12.0f;
 		float jumpProgress = abs(sin(seqTime * PI * 4)); // 4 jumps per second
 
-		float basePosX = rectanglePos.x;
-		float basePosY = rectanglePos.y - 200 - 15;
+		float basePosX = crescentPerch.x;
+		float basePosY = crescentPerch.y;
 		float jumpHeight = 80.0f;
 		glm::vec2 jumpPos(basePosX, basePosY - jumpProgress * jumpHeight);
 
-		drawCrescent(jumpPos, 0);
+		poseCrescent(state, jumpPos, 0);
 	}
 
 	// stays still on top of the rectangle, reacts with rectangle's landing by going up and down a bit
 	if(c >= 13.0f && c < 22.0f) {
-		float basePosX = rectanglePos.x;
-		float basePosY = rectanglePos.y - 200 - 15;
+		float basePosX = crescentPerch.x;
+		float basePosY = crescentPerch.y;
 		glm::vec2 basePos(basePosX, basePosY);
 
 		// rectangle lands at c = 18, c = 19, c = 20, so the crescent reacts at those times too
-		if((c >= 18.0f && c < 18.5f) || (c >= 19.0f && c < 19.5f) || (c >= 20.0f && c < 20.5f)) {
-			float impactTime = fmod(c, 1.0f); // time since last whole second
+		float impactTime = c - lastLandingTime; // time since the rectangle landed
+		if(impactTime >= 0.0f && impactTime < 0.5f) {
 			float impactProgress = ofMap(impactTime, 0.0f, 0.5f, 0.0f, 1.0f);
 			float easedImpact = sin(impactProgress * PI); // easing
 			float impactHeight = 30.0f;
 			glm::vec2 impactPos(basePos.x, basePos.y - easedImpact * impactHeight);
-			drawCrescent(impactPos, 0);
+			poseCrescent(state, impactPos, 0);
 		} else {
-			drawCrescent(basePos, 0);
+			poseCrescent(state, basePos, 0);
 		}
 	}
 
@@ -495,22 +800,22 @@ void ofApp::animateCrescent() {
 		float easedProgress = sin(progress * PI); // easing
 
 		// still needs to follow the rectangle's head
-		float basePosY = rectanglePos.y - 200 - 15;
+		float basePosY = crescentPerch.y;
 		float jumpHeight = 200.0f;
-		float basePosX = rectanglePos.x;
+		float basePosX = crescentPerch.x;
 		glm::vec2 jumpPos(basePosX, basePosY - easedProgress * jumpHeight);
 
 		// flips a few times in the air
 		float angle = ofMap(progress, 0.0, 1.0, 0, PI * 7);
-		drawCrescent(jumpPos, angle);
+		poseCrescent(state, jumpPos, angle);
 	}
 
 	// stays on top of the rectangle 
 	if(c >= 25.0f && c < 26.0f) {
-		float basePosX = rectanglePos.x;
-		float basePosY = rectanglePos.y - 200 - 15;
+		float basePosX = crescentPerch.x;
+		float basePosY = crescentPerch.y;
 		glm::vec2 basePos(basePosX, basePosY);
-		drawCrescent(basePos, PI); // upside down, nighttime
+		poseCrescent(state, basePos, PI); // upside down, nighttime
 	}
 
 	// jumps up and down once more
@@ -518,19 +823,19 @@ void ofApp::animateCrescent() {
 	if(c >= 26.0f && c < 26.5f) {
 		float seqTime = c - 26.0f;
 		float jumpProgress = abs(sin(seqTime * PI * 2));
-		float basePosX = rectanglePos.x;
-		float basePosY = rectanglePos.y - 200 - 15;
+		float basePosX = crescentPerch.x;
+		float basePosY = crescentPerch.y;
 		float jumpHeight = 60.0f;
 		glm::vec2 jumpPos(basePosX, basePosY - jumpProgress * jumpHeight);
-		drawCrescent(jumpPos, PI);
+		poseCrescent(state, jumpPos, PI);
 	}
 
 	// stays for another 1.5 seconds
 	if(c >= 26.5f && c < 28.0f) {
-		float basePosX = rectanglePos.x;
-		float basePosY = rectanglePos.y - 200 - 15;
+		float basePosX = crescentPerch.x;
+		float basePosY = crescentPerch.y;
 		glm::vec2 basePos(basePosX, basePosY);
-		drawCrescent(basePos, PI);
+		poseCrescent(state, basePos, PI);
 	}
 
 	// jumps up and down once more
@@ -538,19 +843,19 @@ void ofApp::animateCrescent() {
 	if(c >= 28.0f && c < 28.5f) {
 		float seqTime = c - 28.0f;
 		float jumpProgress = abs(sin(seqTime * PI * 2));
-		float basePosX = rectanglePos.x;
-		float basePosY = rectanglePos.y - 200 - 15;
+		float basePosX = crescentPerch.x;
+		float basePosY = crescentPerch.y;
 		float jumpHeight = 60.0f;
 		glm::vec2 jumpPos(basePosX, basePosY - jumpProgress * jumpHeight);
-		drawCrescent(jumpPos, PI);
+		poseCrescent(state, jumpPos, PI);
 	}
 
 	// stays for another 1.5 seconds
 	if(c >= 28.5f && c < 30.0f) {
-		float basePosX = rectanglePos.x;
-		float basePosY = rectanglePos.y - 200 - 15;
+		float basePosX = crescentPerch.x;
+		float basePosY = crescentPerch.y;
 		glm::vec2 basePos(basePosX, basePosY);
-		drawCrescent(basePos, PI);
+		poseCrescent(state, basePos, PI);
 	}
 
 	// moves up a bit
@@ -560,8 +865,8 @@ void ofApp::animateCrescent() {
 		float easedProgress = progress * progress * (3.0f - 2.0f * progress); // smoothstep
 
 		// relative to the rectangle's head
-		float basePosX = rectanglePos.x;
-		float basePosY = rectanglePos.y - 200 - 15;
+		float basePosX = crescentPerch.x;
+		float basePosY = crescentPerch.y;
 		float targetX = crescentAnimation.getPointAtPercent(0.0f).x;
 		float targetY = crescentAnimation.getPointAtPercent(0.0f).y;
 		glm::vec2 newPos = glm::vec2(ofLerp(basePosX, targetX, easedProgress), ofLerp(basePosY, targetY, easedProgress));
@@ -569,7 +874,7 @@ void ofApp::animateCrescent() {
 		// angle goes from PI to PI/2
 		float angle = ofMap(easedProgress, 0.0f, 1.0f, PI, PI / 2.0f);
 
-		drawCrescent(newPos, angle);
+		poseCrescent(state, newPos, angle);
 	}
 
 	// spins around the screen superfast
@@ -578,7 +883,7 @@ void ofApp::animateCrescent() {
 		float progress = seqTime / 3.5f;
 		float easedProgress = progress * progress * (3.0f - 2.0f * progress); // smoothstep
 		glm::vec3 pos = crescentAnimation.getPointAtPercent(easedProgress);
-		drawCrescent(pos, PI / 2.0f);
+		poseCrescent(state, pos, PI / 2.0f);
 	}
 
 	// moves left and up a bit
@@ -589,7 +894,7 @@ void ofApp::animateCrescent() {
 		float basePosX = crescentAnimation.getPointAtPercent(1.0f).x;
 		float basePosY = crescentAnimation.getPointAtPercent(1.0f).y;
 		glm::vec2 newPos(basePosX - easedProgress * 320.0f, basePosY - easedProgress * 100.0f);
-		drawCrescent(newPos, PI / 2.0f + PI / 6.0f * easedProgress);
+		poseCrescent(state, newPos, PI / 2.0f + PI / 6.0f * easedProgress);
 	}
 
 	// stays there forever
@@ -597,18 +902,18 @@ void ofApp::animateCrescent() {
 		float basePosX = crescentAnimation.getPointAtPercent(1.0f).x - 320.0f;
 		float basePosY = crescentAnimation.getPointAtPercent(1.0f).y - 100.0f;
 		glm::vec2 basePos(basePosX, basePosY);
-		drawCrescent(basePos, PI / 2.0f + PI / 6.0f);
+		poseCrescent(state, basePos, PI / 2.0f + PI / 6.0f);
 	}
 }
 
 // the "timeline" for the background
-void ofApp::animateBackground() {
+void ofApp::animateBackground(SceneState & state) {
+	const float c = state.c;
+
 	// normally draw windows until the rectangle lands for the third time
 	if(c < 20.0f) {
-		for(auto & window: windows) {
-			window.tiltAngle = 0.0f;
-		}
-		drawBackground(1.0f);
+		state.windowTilt = 0.0f;
+		state.timeOfDay = 1.0f;
 	}
 
 	// after the rectangle lands for the third time, the windows tilt down all at once
@@ -617,67 +922,67 @@ void ofApp::animateBackground() {
 		float seqTime = c - 20.0f;
 		float angleProgress = ofMap(seqTime, 0.0f, 2.0f, 0.0f, 1.0f);
 		angleProgress = abs(sin(angleProgress * PI * 0.5f)); // ease out sine
-		for(auto & window: windows) {
-			window.tiltAngle = window.finalTiltAngle * angleProgress;
-		}
-		drawBackground(1.0f);
+		state.windowTilt = angleProgress;
+		state.timeOfDay = 1.0f;
 	}
 
 	// windows stay tilted, the time of day is dependent on the rotation of the moon
 	if(c >= 22.0f && c < 28.0f) {
-		for(auto & window: windows) {
-			window.tiltAngle = window.finalTiltAngle;
-		}
+		state.windowTilt = 1.0f;
 
 		// crescentAngle is between 0 and 2*PI
 		// when the crescentAngle is upright (0), it is day (1)
 		// when the crescentAngle is upside-down (PI), it is night (0)
-		float timeOfDay = (cos(crescentAngle * 2 * PI) + 1) / 2.0f;
-		drawBackground(timeOfDay);
+		state.timeOfDay = (cos(crescentAngle * 2 * PI) + 1) / 2.0f;
 	}
 
 	// for the rest of the animation, the windows stay tilted and the time of day is night
 	if(c >= 28.0f) {
-		for(auto & window: windows) {
-			window.tiltAngle = window.finalTiltAngle;
-		}
-		drawBackground(0.0f);
+		state.windowTilt = 1.0f;
+		state.timeOfDay = 0.0f;
 	}
 }
 
 // function to draw the background
-void ofApp::drawBackground(const float timeOfDay) {
-	ofSetBackgroundColor(118, 136, 155);
-	for(const auto & window: windows) {
-		ofRectangle rect = window.rect;
-		PivotSide pivot = window.pivotSide;
-		float angle = window.tiltAngle;
+template<PivotSide P, typename DrawWindow>
+void ofApp::drawWindows(const std::vector<Window>::const_iterator begin, const std::vector<Window>::const_iterator end, const float windowTilt, DrawWindow & draw) const {
+	// windows hang on their pivot corner and the other side drops when they tilt (this is for when the rectangle lands for the third time)
+	constexpr Shapes::Point side = Shapes::Pivot<P>::corner;
+	constexpr float direction = P == PivotSide::NONE ? 1.0f : -side.x;
+
+	for(auto window = begin; window != end; ++window) {
+		const ofRectangle & rect = window->rect;
+		const Shapes::Point halfSize = {rect.width / 2, rect.height / 2};
+		glm::vec2 corner(rect.x + halfSize.x * (1 + side.x), rect.y + halfSize.y * (1 + side.y));
+		float angle = direction * window->finalTiltAngle * windowTilt;
+		draw(halfSize, Shapes::transform<P>(corner, angle, 1.0f, halfSize));
+	}
+}
 
-		// interpolate background color based on time of day (0 = night, 1 = day)
-		ofColor bgColor = bgColorNight.getLerped(bgColorDay, timeOfDay);
-		ofSetColor(bgColor);
+template<typename DrawWindow>
+void ofApp::forEachWindow(const float windowTilt, DrawWindow draw) const {
+	// the windows are sorted by pivot side in setup(), so every pivot side is one run of windows
+	auto byPivot = [](const Window & window, const PivotSide pivot) { return window.pivotSide < pivot; };
+	auto left = std::lower_bound(windows.cbegin(), windows.cend(), PivotSide::LEFT, byPivot);
+	auto right = std::lower_bound(left, windows.cend(), PivotSide::RIGHT, byPivot);
+	drawWindows<PivotSide::NONE>(windows.cbegin(), left, windowTilt, draw);
+	drawWindows<PivotSide::LEFT>(left, right, windowTilt, draw);
+	drawWindows<PivotSide::RIGHT>(right, windows.cend(), windowTilt, draw);
+}
 
-		ofPushMatrix();
-		ofTranslate(rect.x + rect.width / 2, rect.y + rect.height / 2);
+void ofApp::drawBackground(const float windowTilt, const float timeOfDay) {
+	ofBackground(118, 136, 155);
 
-		// tilt the window depending on the pivot side and angle (this is for when the rectangle lands for the third time)
-		if(pivot == PivotSide::NONE) {
-			ofRotateRad(angle);
-		} else {
-			glm::vec2 localCorner;
-			if(pivot == PivotSide::LEFT) {
-				localCorner = glm::vec2(-rect.width / 2, -rect.height / 2);
-				angle = -angle; // left pivot needs to rotate clockwise
-			} else {
-				localCorner = glm::vec2(rect.width / 2, -rect.height / 2);
-			}
-			ofTranslate(-localCorner);
-			ofRotateRad(angle);
-			ofTranslate(localCorner);
-		}
-		ofDrawRectangle(-rect.width / 2, -rect.height / 2, rect.width, rect.height);
+	// interpolate background color based on time of day (0 = night, 1 = day)
+	ofColor bgColor = bgColorNight.getLerped(bgColorDay, timeOfDay);
+	ofSetColor(bgColor);
+
+	forEachWindow(windowTilt, [](const Shapes::Point halfSize, const glm::mat4 & transform) {
+		ofPushMatrix();
+		ofMultMatrix(transform);
+		ofDrawRectangle(-halfSize.x, -halfSize.y, halfSize.x * 2, halfSize.y * 2);
 		ofPopMatrix();
-	}
+	});
 }
 
 // everything below is unused, you can stop looking!
@@ -698,6 +1003,48 @@ void ofApp::keyPressed(int key) {
 		c -= 1.0f;
 		c = std::max<float>(c, 0);
 	}
+
+	// after a jump, or going back to evaluating live, the timeline's state has to catch up with the new time
+	// (the worker thread keeps its own clock and owns that state, so it gets told about the jump instead)
+	if(key == ' ' || key == OF_KEY_RIGHT || key == OF_KEY_LEFT || key == 'm') {
+		if(pipelineRunning) {
+			seekTime = c;
+			seekRequested = true;
+		} else {
+			replayTimeline(c);
+		}
+	}
+
+	// m = switch between the baked motion cache and evaluating the timeline every frame
+	// (after asking for the replay above, so the worker never evaluates live from state that hasn't caught up)
+	if(key == 'm') {
+		useMotionCache = !useMotionCache;
+	}
+
+	// t = switch between the pipelined frame loop and evaluating on the main thread
+	if(key == 't') {
+		if(pipelineRunning) {
+			stopPipeline();
+		} else {
+			startPipeline();
+		}
+	}
+
+	// e = export every frame as QOI, p = as PNG, d = as a tile delta stream, any of them again stops the export
+	if(key == 'e' || key == 'p' || key == 'd') {
+		if(exporter.isRunning()) {
+			stopExport();
+		} else if(key == 'd') {
+			startExport(FrameCodec::TILE_DELTA);
+		} else {
+			startExport(key == 'e' ? FrameCodec::QOI : FrameCodec::PNG);
+		}
+	}
+
+	// v = play back the exported tile delta stream
+	if(key == 'v' && !exporter.isRunning()) {
+		playback.open(ofToDataPath("export/frames.tds", true));
+	}
 }
 
 //--------------------------------------------------------------
@@ -1,16 +1,23 @@
 #pragma once
 
 #include "ofMain.h"
+#include "Scene.h"
+#include "MotionCache.h"
+#include "FrameExporter.h"
+#include "SpatialHash.h"
+#include "FrameHandoff.h"
+#include "Rasterizer.h"
 
-enum class PivotSide {
-	NONE,
-	LEFT,
-	RIGHT
+// everything that goes into the spatial hash
+enum class Actor {
+	TRAPEZOID,
+	RECTANGLE,
+	CRESCENT,
+	GROUND
 };
 
 struct Window {
 	ofRectangle rect;
-	float tiltAngle = 0.0f; // in radians
 	float finalTiltAngle = 0.0f; // in radians
 	PivotSide pivotSide = PivotSide::NONE;
 };
@@ -21,6 +28,7 @@ public:
 	void setup();
 	void update();
 	void draw();
+	void exit();
 
 	void keyPressed(int key);
 	void keyReleased(int key);
@@ -35,27 +43,86 @@ public:
 	void gotMessage(ofMessage msg);
 
 	// functions to draw the characters
-	void drawTrapezoid(glm::vec2 pos, float angle, PivotSide pivot = PivotSide::NONE, float scale = 1.0f);
-	void drawRectangle(glm::vec2 pos, float angle, float timeOfDay = 0.0f, float scale = 1.0f);
-	void drawCrescent(glm::vec2 pos, float angle);
+	void drawTrapezoid(const ActorPose & pose);
+	void drawRectangle(const ActorPose & pose);
+	void drawCrescent(const ActorPose & pose);
+
+	// functions to place the characters for the current frame, without drawing anything
+	void poseTrapezoid(SceneState & state, glm::vec2 pos, float angle, PivotSide pivot = PivotSide::NONE, float scale = 1.0f);
+	void poseRectangle(SceneState & state, glm::vec2 pos, float angle, float timeOfDay = 0.0f, float scale = 1.0f);
+	void poseCrescent(SceneState & state, glm::vec2 pos, float angle);
 
 	// functions to animate
-	void animateTrapezoid();
-	void animateRectangle();
-	void animateCrescent();
-	void animateBackground();
+	void animateTrapezoid(SceneState & state);
+	void animateRectangle(SceneState & state);
+	void animateCrescent(SceneState & state);
+	void animateBackground(SceneState & state);
+
+	// runs every timeline at state.c, and a whole frame from a state
+	void evaluate(SceneState & state);
+	void updateContacts(const SceneState & state);
+	const ActorPose * attachCrescent(const SceneState & state);
+	void drawScene(const SceneState & state);
+	void rasterizeScene(const SceneState & state, ofPixels & pixels);
+	void resetAnimationState();
+	void replayTimeline(float time);
 
 	// function to draw the background
-	void drawBackground(float timeOfDay);
+	void drawBackground(float windowTilt, float timeOfDay);
+	// calls draw(halfSize, transform) for every window, with the window centred on (0, 0) before the transform
+	template<typename DrawWindow>
+	void forEachWindow(float windowTilt, DrawWindow draw) const;
+	template<PivotSide P, typename DrawWindow>
+	void drawWindows(std::vector<Window>::const_iterator begin, std::vector<Window>::const_iterator end, float windowTilt, DrawWindow & draw) const;
 
 	float c; // current time in the animation
 	std::vector<Window> windows;
 	ofTrueTypeFont font;
 
+	// the timeline is baked once in setup() and played back from the cache
+	MotionCache motionCache;
+	std::atomic<bool> useMotionCache{true}; // m key switches between the cache and evaluating every frame
+	SceneState scene;
+	const float timeStep = 0.005f; // how far the animation moves every frame
+
+	// pipelined frame loop: a worker thread evaluates the next frame while this one is drawn (t key turns it on and off)
+	void startPipeline();
+	void stopPipeline();
+	void evaluateLoop(float time);
+	std::thread evaluationThread;
+	std::atomic<bool> pipelineRunning{false};
+	FrameHandoff<SceneState> sceneHandoff;
+	std::atomic<float> seekTime{0.0f};
+	std::atomic<bool> seekRequested{false};
+
+	// frame export, every frame is rasterized on the cpu and handed to the encoder threads
+	void startExport(FrameCodec codec);
+	void stopExport();
+	FrameExporter exporter;
+	Rasterizer rasterizer;
+	ofPixels exportPixels;
+	ofTexture exportTexture;
+
+	// plays back an exported tile delta stream instead of the animation (v key)
+	TileStreamReader playback;
+	ofPixels playbackPixels;
+	ofTexture playbackTexture;
+
 	// helper variables for animation
-	glm::vec2 rectanglePos;
-	float rectangleAngle;
 	float crescentAngle;
+	glm::vec2 crescentPerch; // where the crescent sits when it isn't jumping, on top of whatever it rides on
+	int crescentParent;      // the Actor it rides on, -1 until it finds one
+	float lastLandingTime;   // when the rectangle last touched down on the ground
+
+	// bounding boxes of everything on screen, rebuilt after every frame is evaluated
+	SpatialHash spatialHash;
+	std::vector<std::pair<int, int>> contacts;
+	std::vector<int> nearbyActors;
+	bool rectangleOnGround;
+	const float groundY = 800.0f; // the rectangle stands on this
+	// the window size, saved in setup() so evaluate() never asks the window for it from the worker thread
+	float screenWidth;
+	float screenHeight;
 	ofPolyline trapezoidFallAnimation;
 	ofPolyline crescentAnimation;
 	ofPolyline rectangleBigAnimation;